@@ -49,9 +49,29 @@ namespace Memory {
         extend(startsize, true);
     }
 
+    // ------------------------------------------------------------------------
+    void Chain::reset()
+    {
+        if (lastChunk == nullptr) {
+            return;
+        }
+
+        while (lastChunk->prev) {
+            lastChunk = lastChunk->prev;
+        }
+        for (Chunk* chunk = lastChunk; chunk; chunk = chunk->next) {
+            chunk->clear();
+        }
+    }
+
     // ------------------------------------------------------------------------
     void Chain::dealloc()
     {
+        // Chunks after the current one are still owned after back() or reset()
+        while (lastChunk && lastChunk->next) {
+            lastChunk = lastChunk->next;
+        }
+
         Chunk* chunk = lastChunk;
         while (chunk) {
             lastChunk = chunk->prev;
@@ -141,6 +161,18 @@ namespace Memory {
         m_nextsize <<= 1;
     }
 
+    // ------------------------------------------------------------------------
+    // ChainAllocator implementation
+    // ------------------------------------------------------------------------
+    Bytes ChainAllocator::alloc(size_t size)
+    {
+        // Keeps every allocation pointer aligned, chunks start aligned
+        size_t aligned = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+        Bytes memory = m_chain.reserve(aligned);
+        return Bytes{ memory.begin, memory.begin + size };
+    }
+
     // ------------------------------------------------------------------------
     // ChainBuffer implementation
     // ------------------------------------------------------------------------
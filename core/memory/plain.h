@@ -24,8 +24,8 @@ namespace Memory {
             Byte* end;
 
         public:
-            size_t size()  const { return last - (Byte*)this; }
-            void   clear() { last = (Byte*)this; }
+            size_t size()  const { return last - (Byte*)(this + 1); }
+            void   clear() { last = (Byte*)(this + 1); }
         };
 
     public:
@@ -42,6 +42,7 @@ namespace Memory {
         Bytes reserve(size_t count);
         Bytes forward(size_t count);
         void clear(size_t startsize = 0);
+        void reset();
         void back(size_t count);
 
     private:
@@ -61,7 +62,10 @@ namespace Memory {
         ChainAllocator(size_t startsize = 0, BuddyHeap* heap = nullptr)
             : m_chain(startsize, heap) {}
 
-        virtual Bytes alloc(size_t size) override { return m_chain.reserve(size); }
+        virtual Bytes alloc(size_t size) override;
+
+        // Drops every allocation at once, the chunks are kept for reuse
+        void reset() { m_chain.reset(); }
 
     private:
         Chain m_chain;
@@ -21,6 +21,7 @@ extern "C"
 #include "enet/types.h"
 #include "enet/protocol.h"
 #include "enet/list.h"
+#include "enet/wheel.h"
 #include "enet/callbacks.h"
 
 #define ENET_VERSION_MAJOR 1
@@ -62,7 +63,9 @@ typedef enum _ENetSocketOption
    ENET_SOCKOPT_RCVTIMEO  = 6,
    ENET_SOCKOPT_SNDTIMEO  = 7,
    ENET_SOCKOPT_ERROR     = 8,
-   ENET_SOCKOPT_NODELAY   = 9
+   ENET_SOCKOPT_NODELAY   = 9,
+   ENET_SOCKOPT_REUSEPORT = 10,
+   ENET_SOCKOPT_UDP_GRO   = 11
 } ENetSocketOption;
 
 typedef enum _ENetSocketShutdown
@@ -72,6 +75,29 @@ typedef enum _ENetSocketShutdown
     ENET_SOCKET_SHUTDOWN_READ_WRITE = 2
 } ENetSocketShutdown;
 
+/**
+ * Host creation flags, as specified in enet_host_create_ex().
+ */
+typedef enum _ENetHostFlag
+{
+   /** bind the host socket with SO_REUSEPORT, so several hosts may share one
+     * address and let the kernel balance incoming datagrams between them;
+     * host creation fails where sockets lack it, e.g. on Windows */
+   ENET_HOST_FLAG_REUSE_PORT = (1 << 0),
+
+   /** receive and send datagrams in batches, with recvmmsg/sendmmsg where available */
+   ENET_HOST_FLAG_BATCH_IO   = (1 << 1),
+
+   /** let the kernel coalesce received datagrams of a peer (UDP GRO), implies
+     * ENET_HOST_FLAG_BATCH_IO */
+   ENET_HOST_FLAG_UDP_GRO    = (1 << 2),
+
+   /** move datagrams through io_uring with a multishot receive into registered
+     * buffers, Linux only, implies ENET_HOST_FLAG_BATCH_IO and excludes
+     * ENET_HOST_FLAG_UDP_GRO */
+   ENET_HOST_FLAG_IO_URING   = (1 << 3)
+} ENetHostFlag;
+
 #define ENET_HOST_ANY       0
 #define ENET_HOST_BROADCAST 0xFFFFFFFFU
 #define ENET_PORT_ANY       0
@@ -92,6 +118,35 @@ typedef struct _ENetAddress
    enet_uint16 port;
 } ENetAddress;
 
+enum
+{
+   ENET_SOCKET_BATCH_SIZE     = 32,      /**< datagrams moved by one batched socket call */
+   ENET_SOCKET_GRO_BATCH_SIZE = 8,       /**< receive slots of a host with UDP GRO, every slot holds up to 64K */
+   ENET_SOCKET_GRO_SLOT_SIZE  = 65535
+};
+
+/**
+ * Datagrams of one batched socket call, see enet_socket_receive_batch() and
+ * enet_socket_send_batch(). Slot i occupies data [i * slotSize, (i + 1) * slotSize).
+ */
+typedef struct _ENetSocketBatch
+{
+   size_t        capacity;                                  /**< number of slots, at most ENET_SOCKET_BATCH_SIZE */
+   size_t        slotSize;
+   size_t        count;                                     /**< slots holding datagrams */
+   size_t        next;                                      /**< first slot not consumed yet */
+   size_t        offset;                                    /**< consumed bytes of the next slot */
+   enet_uint8 *  data;
+   ENetAddress   addresses [ENET_SOCKET_BATCH_SIZE];
+   size_t        lengths [ENET_SOCKET_BATCH_SIZE];
+   size_t        segmentSizes [ENET_SOCKET_BATCH_SIZE];     /**< size of the coalesced datagrams of a GRO slot, 0 for a single datagram */
+} ENetSocketBatch;
+
+typedef struct _ENetUring ENetUring;
+
+/** Set of hosts and application sockets which one thread sleeps on, see enet_waitset_wait() */
+typedef struct _ENetWaitSet ENetWaitSet;
+
 /**
  * Packet flag bit constants.
  *
@@ -122,6 +177,20 @@ typedef enum _ENetPacketFlag
 
 typedef void (ENET_CALLBACK * ENetPacketFreeCallback) (struct _ENetPacket *);
 
+/** An allocator of the commands, acknowledgements and packets of a host, see enet_host_allocator().
+ */
+typedef struct _ENetAllocator
+{
+   /** Context data for the allocator. */
+   void * context;
+   /** Allocates size bytes aligned for any ENet structure. Should return NULL on failure. */
+   void * (ENET_CALLBACK * allocate) (void * context, size_t size);
+   /** Releases memory returned by allocate, size is the one it was allocated with. */
+   void (ENET_CALLBACK * deallocate) (void * context, void * memory, size_t size);
+   /** Destroys the context when the allocator is replaced or the host is destroyed. May be NULL. */
+   void (ENET_CALLBACK * destroy) (void * context);
+} ENetAllocator;
+
 /**
  * ENet packet structure.
  *
@@ -149,6 +218,9 @@ typedef struct _ENetPacket
    size_t                   dataLength;      /**< length of data */
    ENetPacketFreeCallback   freeCallback;    /**< function to be called when the packet is no longer in use */
    void *                   userData;        /**< application private data, may be freely modified */
+   ENetBuffer *             segments;        /**< user supplied data segments of a gathered packet, NULL if data is used */
+   size_t                   segmentCount;    /**< number of data segments of a gathered packet */
+   ENetAllocator *          allocator;       /**< allocator of the host which created the packet, NULL for enet_malloc() */
 } ENetPacket;
 
 typedef struct _ENetAcknowledgement
@@ -308,11 +380,14 @@ typedef struct _ENetPeer
    ENetList      outgoingUnreliableCommands;
    ENetList      dispatchedCommands;
    int           needsDispatch;
+   ENetTimer     timer;              /**< visits the peer in the send pass when retransmits, pings or queued commands are due */
+   ENetListNode  connectedList;      /**< link in the host's connectedPeerList while connected or disconnecting later */
    enet_uint16   incomingUnsequencedGroup;
    enet_uint16   outgoingUnsequencedGroup;
    enet_uint32   unsequencedWindow [ENET_PEER_UNSEQUENCED_WINDOW_SIZE / 32]; 
    enet_uint32   eventData;
    size_t        totalWaitingData;
+   const struct _ENetCompressor * compressor; /**< compressor of the datagrams exchanged with the peer, NULL for the host's one */
 } ENetPeer;
 
 /** An ENet packet compressor for compressing UDP packets before socket sends or receives.
@@ -366,6 +441,7 @@ typedef struct _ENetHost
    size_t               channelLimit;                /**< maximum number of channels allowed for connected peers */
    enet_uint32          serviceTime;
    ENetList             dispatchQueue;
+   ENetTimerWheel       timerWheel;                  /**< peer timers, only expired peers are visited when sending */
    int                  continueSending;
    size_t               packetSize;
    enet_uint16          headerFlags;
@@ -375,6 +451,7 @@ typedef struct _ENetHost
    size_t               bufferCount;
    ENetChecksumCallback checksum;                    /**< callback the user can set to enable packet checksums for this host */
    ENetCompressor       compressor;
+   ENetAllocator        allocator;                   /**< allocator of commands and packets, enet_malloc() if allocate is NULL */
    enet_uint8           packetData [2][ENET_PROTOCOL_MAXIMUM_MTU];
    ENetAddress          receivedAddress;
    enet_uint8 *         receivedData;
@@ -385,12 +462,27 @@ typedef struct _ENetHost
    enet_uint32          totalReceivedPackets;        /**< total UDP packets received, user should reset to 0 as needed to prevent overflow */
    ENetInterceptCallback intercept;                  /**< callback the user can set to intercept received raw UDP packets */
    size_t               connectedPeers;
+   ENetList             connectedPeerList;           /**< peers counted in connectedPeers, walked instead of the whole peer array */
    size_t               bandwidthLimitedPeers;
    size_t               duplicatePeers;              /**< optional number of allowed peers from duplicate IPs, defaults to ENET_PROTOCOL_MAXIMUM_PEER_ID */
    size_t               maximumPacketSize;           /**< the maximum allowable packet size that may be sent or received on a peer */
    size_t               maximumWaitingData;          /**< the maximum aggregate amount of buffer space a peer may use waiting for packets to be delivered */
+   ENetHostWaiter       waiter;
+   ENetSocketBatch *    receiveBatch;                /**< batched receive slots, NULL without ENET_HOST_FLAG_BATCH_IO */
+   ENetSocketBatch *    sendBatch;                   /**< datagrams queued for the next batched send */
+   ENetUring *          uring;                       /**< io_uring backend of the batches, NULL without ENET_HOST_FLAG_IO_URING */
 } ENetHost;
 
+/**
+ * A host or application socket reported by enet_waitset_wait().
+ */
+typedef struct _ENetWaitEvent
+{
+   ENetHost *   host;      /**< host which should be serviced, NULL for an application socket */
+   ENetSocket   socket;    /**< host socket or the readable application socket */
+   void *       data;      /**< user data given when the host or socket was added */
+} ENetWaitEvent;
+
 /**
  * An ENet event type, as specified in @ref ENetEvent.
  */
@@ -493,6 +585,8 @@ ENET_API ENetSocket enet_socket_accept (ENetSocket, ENetAddress *);
 ENET_API int        enet_socket_connect (ENetSocket, const ENetAddress *);
 ENET_API int        enet_socket_send (ENetSocket, const ENetAddress *, const ENetBuffer *, size_t);
 ENET_API int        enet_socket_receive (ENetSocket, ENetAddress *, ENetBuffer *, size_t);
+ENET_API int        enet_socket_send_batch (ENetSocket, ENetSocketBatch *);
+ENET_API int        enet_socket_receive_batch (ENetSocket, ENetSocketBatch *);
 ENET_API int        enet_socket_wait (ENetSocket, enet_uint32 *, enet_uint32);
 ENET_API int        enet_socket_set_option (ENetSocket, ENetSocketOption, int);
 ENET_API int        enet_socket_get_option (ENetSocket, ENetSocketOption, int *);
@@ -500,6 +594,17 @@ ENET_API int        enet_socket_shutdown (ENetSocket, ENetSocketShutdown);
 ENET_API void       enet_socket_destroy (ENetSocket);
 ENET_API int        enet_socketset_select (ENetSocket, ENetSocketSet *, ENetSocketSet *, enet_uint32);
 
+extern int          enet_host_waiter_create (ENetHostWaiter *, ENetSocket);
+extern void         enet_host_waiter_destroy (ENetHostWaiter *);
+extern int          enet_host_waiter_wait (ENetHostWaiter *, ENetSocket, enet_uint32);
+extern void         enet_host_waiter_wake (ENetHostWaiter *);
+
+extern ENetUring *  enet_uring_create (ENetSocket, ENetHostWaiter *);
+extern void         enet_uring_destroy (ENetUring *);
+extern int          enet_uring_send_batch (ENetUring *, ENetSocketBatch *);
+extern int          enet_uring_receive_batch (ENetUring *, ENetSocketBatch *);
+extern int          enet_uring_pending (ENetUring *);
+
 /** @} */
 
 /** @defgroup Address ENet address functions
@@ -538,25 +643,44 @@ ENET_API int enet_address_get_host (const ENetAddress * address, char * hostName
 /** @} */
 
 ENET_API ENetPacket * enet_packet_create (const void *, size_t, enet_uint32);
+ENET_API ENetPacket * enet_packet_create_gather (const ENetBuffer *, size_t, enet_uint32);
 ENET_API void         enet_packet_destroy (ENetPacket *);
 ENET_API int          enet_packet_resize  (ENetPacket *, size_t);
+ENET_API ENetPacket * enet_host_packet_create (ENetHost *, const void *, size_t, enet_uint32);
+ENET_API ENetPacket * enet_host_packet_create_gather (ENetHost *, const ENetBuffer *, size_t, enet_uint32);
+ENET_API size_t       enet_packet_gather (const ENetPacket *, size_t, size_t, ENetBuffer *);
 ENET_API enet_uint32  enet_crc32 (const ENetBuffer *, size_t);
                 
 ENET_API ENetHost * enet_host_create (const ENetAddress *, size_t, size_t, enet_uint32, enet_uint32);
+ENET_API ENetHost * enet_host_create_ex (const ENetAddress *, size_t, size_t, enet_uint32, enet_uint32, enet_uint32);
 ENET_API void       enet_host_destroy (ENetHost *);
 ENET_API ENetPeer * enet_host_connect (ENetHost *, const ENetAddress *, size_t, enet_uint32);
 ENET_API int        enet_host_check_events (ENetHost *, ENetEvent *);
 ENET_API int        enet_host_service (ENetHost *, ENetEvent *, enet_uint32);
 ENET_API void       enet_host_flush (ENetHost *);
+ENET_API enet_uint32 enet_host_get_timeout (ENetHost *, enet_uint32);
+ENET_API int        enet_host_wait (ENetHost *, enet_uint32);
+ENET_API void       enet_host_wake (ENetHost *);
+
+ENET_API ENetWaitSet * enet_waitset_create (void);
+ENET_API void       enet_waitset_destroy (ENetWaitSet *);
+ENET_API int        enet_waitset_add_host (ENetWaitSet *, ENetHost *, void *);
+ENET_API void       enet_waitset_remove_host (ENetWaitSet *, ENetHost *);
+ENET_API int        enet_waitset_add_socket (ENetWaitSet *, ENetSocket, void *);
+ENET_API void       enet_waitset_remove_socket (ENetWaitSet *, ENetSocket);
+ENET_API int        enet_waitset_wait (ENetWaitSet *, ENetWaitEvent *, size_t, enet_uint32);
 ENET_API void       enet_host_broadcast (ENetHost *, enet_uint8, ENetPacket *);
 ENET_API void       enet_host_compress (ENetHost *, const ENetCompressor *);
+ENET_API void       enet_host_allocator (ENetHost *, const ENetAllocator *);
 ENET_API int        enet_host_compress_with_range_coder (ENetHost * host);
+ENET_API int        enet_host_compress_with_lz (ENetHost * host, const void * dictionary, size_t dictionaryLength);
 ENET_API void       enet_host_channel_limit (ENetHost *, size_t);
 ENET_API void       enet_host_bandwidth_limit (ENetHost *, enet_uint32, enet_uint32);
 extern   void       enet_host_bandwidth_throttle (ENetHost *);
 extern  enet_uint32 enet_host_random_seed (void);
 
 ENET_API int                 enet_peer_send (ENetPeer *, enet_uint8, ENetPacket *);
+ENET_API size_t              enet_peer_get_fragment_length (const ENetPeer *);
 ENET_API ENetPacket *        enet_peer_receive (ENetPeer *, enet_uint8 * channelID);
 ENET_API void                enet_peer_ping (ENetPeer *);
 ENET_API void                enet_peer_ping_interval (ENetPeer *, enet_uint32);
@@ -566,6 +690,7 @@ ENET_API void                enet_peer_disconnect (ENetPeer *, enet_uint32);
 ENET_API void                enet_peer_disconnect_now (ENetPeer *, enet_uint32);
 ENET_API void                enet_peer_disconnect_later (ENetPeer *, enet_uint32);
 ENET_API void                enet_peer_throttle_configure (ENetPeer *, enet_uint32, enet_uint32, enet_uint32);
+ENET_API void                enet_peer_compress (ENetPeer *, const ENetCompressor *);
 extern int                   enet_peer_throttle (ENetPeer *, enet_uint32);
 extern void                  enet_peer_reset_queues (ENetPeer *);
 extern void                  enet_peer_setup_outgoing_command (ENetPeer *, ENetOutgoingCommand *);
@@ -576,14 +701,23 @@ extern void                  enet_peer_dispatch_incoming_unreliable_commands (EN
 extern void                  enet_peer_dispatch_incoming_reliable_commands (ENetPeer *, ENetChannel *);
 extern void                  enet_peer_on_connect (ENetPeer *);
 extern void                  enet_peer_on_disconnect (ENetPeer *);
+extern void                  enet_peer_schedule (ENetPeer *, enet_uint32);
 
 ENET_API void * enet_range_coder_create (void);
 ENET_API void   enet_range_coder_destroy (void *);
 ENET_API size_t enet_range_coder_compress (void *, const ENetBuffer *, size_t, size_t, enet_uint8 *, size_t);
 ENET_API size_t enet_range_coder_decompress (void *, const enet_uint8 *, size_t, enet_uint8 *, size_t);
+
+ENET_API void * enet_lz_create (const void *, size_t);
+ENET_API void   enet_lz_destroy (void *);
+ENET_API size_t enet_lz_compress (void *, const ENetBuffer *, size_t, size_t, enet_uint8 *, size_t);
+ENET_API size_t enet_lz_decompress (void *, const enet_uint8 *, size_t, enet_uint8 *, size_t);
    
 extern size_t enet_protocol_command_size (enet_uint8);
 
+extern void * enet_allocator_malloc (const ENetAllocator *, size_t);
+extern void   enet_allocator_free (const ENetAllocator *, void *, size_t);
+
 #ifdef __cplusplus
 }
 #endif
@@ -51,3 +51,21 @@ enet_free (void * memory)
    callbacks.free (memory);
 }
 
+void *
+enet_allocator_malloc (const ENetAllocator * allocator, size_t size)
+{
+   if (allocator == NULL || allocator -> allocate == NULL)
+     return enet_malloc (size);
+
+   return (* allocator -> allocate) (allocator -> context, size);
+}
+
+void
+enet_allocator_free (const ENetAllocator * allocator, void * memory, size_t size)
+{
+   if (allocator == NULL || allocator -> allocate == NULL)
+     enet_free (memory);
+   else
+     (* allocator -> deallocate) (allocator -> context, memory, size);
+}
+
@@ -3,13 +3,47 @@
  @brief ENet host management functions
 */
 #define ENET_BUILDING_LIB 1
+#include <stddef.h>
 #include <string.h>
 #include "enet/enet.h"
+#include "enet/time.h"
 
 /** @defgroup host ENet host functions
     @{
 */
 
+static ENetSocketBatch *
+enet_host_batch_create (size_t capacity, size_t slotSize)
+{
+    ENetSocketBatch * batch = (ENetSocketBatch *) enet_malloc (sizeof (ENetSocketBatch));
+    if (batch == NULL)
+      return NULL;
+    memset (batch, 0, sizeof (ENetSocketBatch));
+
+    batch -> data = (enet_uint8 *) enet_malloc (capacity * slotSize);
+    if (batch -> data == NULL)
+    {
+       enet_free (batch);
+
+       return NULL;
+    }
+
+    batch -> capacity = capacity;
+    batch -> slotSize = slotSize;
+
+    return batch;
+}
+
+static void
+enet_host_batch_destroy (ENetSocketBatch * batch)
+{
+    if (batch == NULL)
+      return;
+
+    enet_free (batch -> data);
+    enet_free (batch);
+}
+
 /** Creates a host for communicating to peers.  
 
     @param address   the address at which other peers may connect to this host.  If NULL, then no peers may connect to the host.
@@ -27,11 +61,31 @@
 */
 ENetHost *
 enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
+{
+    return enet_host_create_ex (address, peerCount, channelLimit, incomingBandwidth, outgoingBandwidth, 0);
+}
+
+/** Creates a host for communicating to peers with additional creation flags.
+
+    @param address   the address at which other peers may connect to this host.  If NULL, then no peers may connect to the host.
+    @param peerCount the maximum number of peers that should be allocated for the host.
+    @param channelLimit the maximum number of channels allowed; if 0, then this is equivalent to ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT
+    @param incomingBandwidth downstream bandwidth of the host in bytes/second; if 0, ENet will assume unlimited bandwidth.
+    @param outgoingBandwidth upstream bandwidth of the host in bytes/second; if 0, ENet will assume unlimited bandwidth.
+    @param flags     bitwise-or of ENetHostFlag constants
+
+    @returns the host on success and NULL on failure, including when a requested flag is not supported by the platform
+
+    @sa enet_host_create
+*/
+ENetHost *
+enet_host_create_ex (const ENetAddress * address, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth, enet_uint32 flags)
 {
     ENetHost * host;
     ENetPeer * currentPeer;
 
-    if (peerCount > ENET_PROTOCOL_MAXIMUM_PEER_ID)
+    if (peerCount > ENET_PROTOCOL_MAXIMUM_PEER_ID ||
+        ((flags & ENET_HOST_FLAG_IO_URING) && (flags & ENET_HOST_FLAG_UDP_GRO)))
       return NULL;
 
     host = (ENetHost *) enet_malloc (sizeof (ENetHost));
@@ -49,7 +103,9 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
     memset (host -> peers, 0, peerCount * sizeof (ENetPeer));
 
     host -> socket = enet_socket_create (ENET_SOCKET_TYPE_DATAGRAM);
-    if (host -> socket == ENET_SOCKET_NULL || (address != NULL && enet_socket_bind (host -> socket, address) < 0))
+    if (host -> socket == ENET_SOCKET_NULL ||
+        ((flags & ENET_HOST_FLAG_REUSE_PORT) && enet_socket_set_option (host -> socket, ENET_SOCKOPT_REUSEPORT, 1) < 0) ||
+        (address != NULL && enet_socket_bind (host -> socket, address) < 0))
     {
        if (host -> socket != ENET_SOCKET_NULL)
          enet_socket_destroy (host -> socket);
@@ -60,6 +116,40 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
        return NULL;
     }
 
+    if (enet_host_waiter_create (& host -> waiter, host -> socket) < 0)
+    {
+       enet_socket_destroy (host -> socket);
+
+       enet_free (host -> peers);
+       enet_free (host);
+
+       return NULL;
+    }
+
+    if (flags & (ENET_HOST_FLAG_BATCH_IO | ENET_HOST_FLAG_UDP_GRO | ENET_HOST_FLAG_IO_URING))
+    {
+       int gro = (flags & ENET_HOST_FLAG_UDP_GRO) != 0;
+
+       host -> receiveBatch = gro ? enet_host_batch_create (ENET_SOCKET_GRO_BATCH_SIZE, ENET_SOCKET_GRO_SLOT_SIZE)
+                                  : enet_host_batch_create (ENET_SOCKET_BATCH_SIZE, ENET_PROTOCOL_MAXIMUM_MTU);
+       host -> sendBatch = enet_host_batch_create (ENET_SOCKET_BATCH_SIZE, ENET_PROTOCOL_MAXIMUM_MTU);
+
+       if (host -> receiveBatch == NULL || host -> sendBatch == NULL ||
+           (gro && enet_socket_set_option (host -> socket, ENET_SOCKOPT_UDP_GRO, 1) < 0) ||
+           ((flags & ENET_HOST_FLAG_IO_URING) && (host -> uring = enet_uring_create (host -> socket, & host -> waiter)) == NULL))
+       {
+          enet_host_batch_destroy (host -> receiveBatch);
+          enet_host_batch_destroy (host -> sendBatch);
+          enet_host_waiter_destroy (& host -> waiter);
+          enet_socket_destroy (host -> socket);
+
+          enet_free (host -> peers);
+          enet_free (host);
+
+          return NULL;
+       }
+    }
+
     enet_socket_set_option (host -> socket, ENET_SOCKOPT_NONBLOCK, 1);
     enet_socket_set_option (host -> socket, ENET_SOCKOPT_BROADCAST, 1);
     enet_socket_set_option (host -> socket, ENET_SOCKOPT_RCVBUF, ENET_HOST_RECEIVE_BUFFER_SIZE);
@@ -108,9 +198,16 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
     host -> compressor.decompress = NULL;
     host -> compressor.destroy = NULL;
 
+    host -> allocator.context = NULL;
+    host -> allocator.allocate = NULL;
+    host -> allocator.deallocate = NULL;
+    host -> allocator.destroy = NULL;
+
     host -> intercept = NULL;
 
     enet_list_clear (& host -> dispatchQueue);
+    enet_list_clear (& host -> connectedPeerList);
+    enet_timer_wheel_init (& host -> timerWheel, enet_time_get ());
 
     for (currentPeer = host -> peers;
          currentPeer < & host -> peers [host -> peerCount];
@@ -145,6 +242,10 @@ enet_host_destroy (ENetHost * host)
     if (host == NULL)
       return;
 
+    enet_uring_destroy (host -> uring);
+    enet_host_batch_destroy (host -> receiveBatch);
+    enet_host_batch_destroy (host -> sendBatch);
+    enet_host_waiter_destroy (& host -> waiter);
     enet_socket_destroy (host -> socket);
 
     for (currentPeer = host -> peers;
@@ -157,6 +258,9 @@ enet_host_destroy (ENetHost * host)
     if (host -> compressor.context != NULL && host -> compressor.destroy)
       (* host -> compressor.destroy) (host -> compressor.context);
 
+    if (host -> allocator.allocate != NULL && host -> allocator.destroy)
+      (* host -> allocator.destroy) (host -> allocator.context);
+
     enet_free (host -> peers);
     enet_free (host);
 }
@@ -260,16 +364,18 @@ enet_host_connect (ENetHost * host, const ENetAddress * address, size_t channelC
 void
 enet_host_broadcast (ENetHost * host, enet_uint8 channelID, ENetPacket * packet)
 {
-    ENetPeer * currentPeer;
+    ENetListIterator currentPeer;
 
-    for (currentPeer = host -> peers;
-         currentPeer < & host -> peers [host -> peerCount];
-         ++ currentPeer)
+    for (currentPeer = enet_list_begin (& host -> connectedPeerList);
+         currentPeer != enet_list_end (& host -> connectedPeerList);
+         currentPeer = enet_list_next (currentPeer))
     {
-       if (currentPeer -> state != ENET_PEER_STATE_CONNECTED)
+       ENetPeer * peer = (ENetPeer *) ((enet_uint8 *) currentPeer - offsetof (ENetPeer, connectedList));
+
+       if (peer -> state != ENET_PEER_STATE_CONNECTED)
          continue;
 
-       enet_peer_send (currentPeer, channelID, packet);
+       enet_peer_send (peer, channelID, packet);
     }
 
     if (packet -> referenceCount == 0)
@@ -292,6 +398,23 @@ enet_host_compress (ENetHost * host, const ENetCompressor * compressor)
       host -> compressor.context = NULL;
 }
 
+/** Sets the allocator the host should use for its commands, acknowledgements and received packets.
+    @param host host to set the allocator for
+    @param allocator callbacks of the allocator; if NULL, then enet_malloc() is used
+    @remarks must be set while the host has no peers, memory is always released to the allocator it came from
+*/
+void
+enet_host_allocator (ENetHost * host, const ENetAllocator * allocator)
+{
+    if (host -> allocator.allocate != NULL && host -> allocator.destroy)
+      (* host -> allocator.destroy) (host -> allocator.context);
+
+    if (allocator)
+      host -> allocator = * allocator;
+    else
+      host -> allocator.allocate = NULL;
+}
+
 /** Limits the maximum allowed channels of future incoming connections.
     @param host host to limit
     @param channelLimit the maximum number of channels allowed; if 0, then this is equivalent to ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT
@@ -335,6 +458,7 @@ enet_host_bandwidth_throttle (ENetHost * host)
            throttle = 0,
            bandwidthLimit = 0;
     int needsAdjustment = host -> bandwidthLimitedPeers > 0 ? 1 : 0;
+    ENetListIterator currentPeer;
     ENetPeer * peer;
     ENetProtocol command;
 
@@ -351,12 +475,11 @@ enet_host_bandwidth_throttle (ENetHost * host)
         dataTotal = 0;
         bandwidth = (host -> outgoingBandwidth * elapsedTime) / 1000;
 
-        for (peer = host -> peers;
-             peer < & host -> peers [host -> peerCount];
-            ++ peer)
+        for (currentPeer = enet_list_begin (& host -> connectedPeerList);
+             currentPeer != enet_list_end (& host -> connectedPeerList);
+             currentPeer = enet_list_next (currentPeer))
         {
-            if (peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER)
-              continue;
+            peer = (ENetPeer *) ((enet_uint8 *) currentPeer - offsetof (ENetPeer, connectedList));
 
             dataTotal += peer -> outgoingDataTotal;
         }
@@ -371,14 +494,15 @@ enet_host_bandwidth_throttle (ENetHost * host)
         else
           throttle = (bandwidth * ENET_PEER_PACKET_THROTTLE_SCALE) / dataTotal;
 
-        for (peer = host -> peers;
-             peer < & host -> peers [host -> peerCount];
-             ++ peer)
+        for (currentPeer = enet_list_begin (& host -> connectedPeerList);
+             currentPeer != enet_list_end (& host -> connectedPeerList);
+             currentPeer = enet_list_next (currentPeer))
         {
             enet_uint32 peerBandwidth;
+
+            peer = (ENetPeer *) ((enet_uint8 *) currentPeer - offsetof (ENetPeer, connectedList));
             
-            if ((peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER) ||
-                peer -> incomingBandwidth == 0 ||
+            if (peer -> incomingBandwidth == 0 ||
                 peer -> outgoingBandwidthThrottleEpoch == timeCurrent)
               continue;
 
@@ -414,12 +538,13 @@ enet_host_bandwidth_throttle (ENetHost * host)
         else
           throttle = (bandwidth * ENET_PEER_PACKET_THROTTLE_SCALE) / dataTotal;
 
-        for (peer = host -> peers;
-             peer < & host -> peers [host -> peerCount];
-             ++ peer)
+        for (currentPeer = enet_list_begin (& host -> connectedPeerList);
+             currentPeer != enet_list_end (& host -> connectedPeerList);
+             currentPeer = enet_list_next (currentPeer))
         {
-            if ((peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER) ||
-                peer -> outgoingBandwidthThrottleEpoch == timeCurrent)
+            peer = (ENetPeer *) ((enet_uint8 *) currentPeer - offsetof (ENetPeer, connectedList));
+
+            if (peer -> outgoingBandwidthThrottleEpoch == timeCurrent)
               continue;
 
             peer -> packetThrottleLimit = throttle;
@@ -448,12 +573,13 @@ enet_host_bandwidth_throttle (ENetHost * host)
            needsAdjustment = 0;
            bandwidthLimit = bandwidth / peersRemaining;
 
-           for (peer = host -> peers;
-                peer < & host -> peers [host -> peerCount];
-                ++ peer)
+           for (currentPeer = enet_list_begin (& host -> connectedPeerList);
+                currentPeer != enet_list_end (& host -> connectedPeerList);
+                currentPeer = enet_list_next (currentPeer))
            {
-               if ((peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER) ||
-                   peer -> incomingBandwidthThrottleEpoch == timeCurrent)
+               peer = (ENetPeer *) ((enet_uint8 *) currentPeer - offsetof (ENetPeer, connectedList));
+
+               if (peer -> incomingBandwidthThrottleEpoch == timeCurrent)
                  continue;
 
                if (peer -> outgoingBandwidth > 0 &&
@@ -468,12 +594,11 @@ enet_host_bandwidth_throttle (ENetHost * host)
            }
        }
 
-       for (peer = host -> peers;
-            peer < & host -> peers [host -> peerCount];
-            ++ peer)
+       for (currentPeer = enet_list_begin (& host -> connectedPeerList);
+            currentPeer != enet_list_end (& host -> connectedPeerList);
+            currentPeer = enet_list_next (currentPeer))
        {
-           if (peer -> state != ENET_PEER_STATE_CONNECTED && peer -> state != ENET_PEER_STATE_DISCONNECT_LATER)
-             continue;
+           peer = (ENetPeer *) ((enet_uint8 *) currentPeer - offsetof (ENetPeer, connectedList));
 
            command.header.command = ENET_PROTOCOL_COMMAND_BANDWIDTH_LIMIT | ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
            command.header.channelID = 0xFF;
@@ -489,4 +614,70 @@ enet_host_bandwidth_throttle (ENetHost * host)
     }
 }
     
+/** Computes how long the host may sleep before enet_host_service() has work to do.
+
+    @param host    host to check
+    @param timeout upper bound of the result in milliseconds
+    @returns milliseconds until the earliest retransmit, ping, timeout check or bandwidth
+    throttle of the host, 0 if something is already due
+    @remarks packets arriving on the socket are not accounted, use enet_host_wait() to sleep on them
+*/
+enet_uint32
+enet_host_get_timeout (ENetHost * host, enet_uint32 timeout)
+{
+    enet_uint32 timeCurrent = enet_time_get (),
+           deadline = timeCurrent + timeout,
+           peerTime;
+
+    if (! enet_list_empty (& host -> dispatchQueue) ||
+        (host -> receiveBatch != NULL && host -> receiveBatch -> next < host -> receiveBatch -> count) ||
+        (host -> uring != NULL && enet_uring_pending (host -> uring)))
+      return 0;
+
+    if (host -> incomingBandwidth != 0 || host -> outgoingBandwidth != 0 ||
+        host -> recalculateBandwidthLimits || host -> bandwidthLimitedPeers > 0)
+    {
+       enet_uint32 throttleTime = host -> bandwidthThrottleEpoch + ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL;
+
+       if (ENET_TIME_LESS (throttleTime, deadline))
+         deadline = throttleTime;
+    }
+
+    /* Queued commands and acknowledgements make their peer expire at once */
+    if (enet_timer_wheel_next (& host -> timerWheel, & peerTime) &&
+        ENET_TIME_LESS (peerTime, deadline))
+      deadline = peerTime;
+
+    if (ENET_TIME_LESS_EQUAL (deadline, timeCurrent))
+      return 0;
+
+    return ENET_TIME_DIFFERENCE (deadline, timeCurrent);
+}
+
+/** Blocks until the host socket has incoming data, enet_host_wake() is called or the timeout expires.
+
+    @param host    host to wait on
+    @param timeout number of milliseconds to wait
+    @retval > 0 if the host was woken before the timeout
+    @retval 0 if the timeout expired
+    @retval < 0 on failure
+    @remarks only the thread which services the host may wait on it
+*/
+int
+enet_host_wait (ENetHost * host, enet_uint32 timeout)
+{
+    return enet_host_waiter_wait (& host -> waiter, host -> socket, timeout);
+}
+
+/** Interrupts enet_host_wait() on the host, or the next call to it if none is in progress.
+
+    @param host host to wake
+    @remarks may be called from any thread
+*/
+void
+enet_host_wake (ENetHost * host)
+{
+    enet_host_waiter_wake (& host -> waiter);
+}
+
 /** @} */
@@ -0,0 +1,378 @@
+/**
+ @file lz.c
+ @brief A byte oriented LZ77 packet codec with an optional preset dictionary
+*/
+#define ENET_BUILDING_LIB 1
+#include <string.h>
+#include "enet/enet.h"
+
+enum
+{
+    ENET_LZ_HASH_BITS = 12,
+    ENET_LZ_HASH_SIZE = 1 << ENET_LZ_HASH_BITS,
+    ENET_LZ_HASH_EMPTY = 0xFFFF,
+
+    ENET_LZ_MINIMUM_MATCH = 4,
+    ENET_LZ_LENGTH_MASK = 15,
+
+    ENET_LZ_MAXIMUM_DICTIONARY = 32768,
+    ENET_LZ_WINDOW_SIZE = ENET_LZ_MAXIMUM_DICTIONARY + ENET_PROTOCOL_MAXIMUM_MTU
+};
+
+/** The dictionary sits at the start of the window, packets are copied or decoded right
+    behind it so that matches may reach back into the dictionary. Every window position
+    fits an offset of 16 bits. Compressed packets start with the id of the dictionary
+    they reference, zero for none, so a codec decodes plain packets of any other one.
+*/
+typedef struct _ENetLZ
+{
+    size_t dictionaryLength;
+    enet_uint8 dictionaryId;
+    enet_uint16 epoch;
+    enet_uint16 dictionaryTable [ENET_LZ_HASH_SIZE];   /**< positions of dictionary strings, built once */
+    enet_uint32 packetTable [ENET_LZ_HASH_SIZE];       /**< epoch << 16 | position of strings of the current packet */
+    enet_uint8 window [ENET_LZ_WINDOW_SIZE];
+} ENetLZ;
+
+static enet_uint32
+enet_lz_read (const enet_uint8 * data)
+{
+    enet_uint32 value;
+
+    memcpy (& value, data, sizeof (value));
+
+    return value;
+}
+
+static enet_uint32
+enet_lz_hash (const enet_uint8 * data)
+{
+    return (enet_lz_read (data) * 2654435761U) >> (32 - ENET_LZ_HASH_BITS);
+}
+
+/** Ids of different dictionaries may collide, a mismatch is only likely to be detected. */
+static enet_uint8
+enet_lz_dictionary_id (const enet_uint8 * dictionary, size_t dictionaryLength)
+{
+    enet_uint32 hash = 2166136261U;
+
+    if (dictionaryLength == 0)
+      return 0;
+
+    while (dictionaryLength -- > 0)
+      hash = (hash ^ * dictionary ++) * 16777619U;
+
+    return (enet_uint8) (hash % 255 + 1);
+}
+
+/** Creates a codec primed with a dictionary, both ends of a connection must use the same one.
+    @param dictionary   data the packets are likely to repeat, the most frequent strings last; may be NULL
+    @param dictionaryLength length of the dictionary, only its last 32 KiB are used
+    @returns the codec context on success, NULL on failure
+*/
+void *
+enet_lz_create (const void * dictionary, size_t dictionaryLength)
+{
+    ENetLZ * lz = (ENetLZ *) enet_malloc (sizeof (ENetLZ));
+    size_t position;
+
+    if (lz == NULL)
+      return NULL;
+
+    if (dictionary == NULL)
+      dictionaryLength = 0;
+    else
+    if (dictionaryLength > ENET_LZ_MAXIMUM_DICTIONARY)
+    {
+        dictionary = (const enet_uint8 *) dictionary + dictionaryLength - ENET_LZ_MAXIMUM_DICTIONARY;
+        dictionaryLength = ENET_LZ_MAXIMUM_DICTIONARY;
+    }
+
+    lz -> dictionaryLength = dictionaryLength;
+    lz -> dictionaryId = enet_lz_dictionary_id ((const enet_uint8 *) dictionary, dictionaryLength);
+    lz -> epoch = 1;
+
+    memset (lz -> dictionaryTable, 0xFF, sizeof (lz -> dictionaryTable));
+    memset (lz -> packetTable, 0, sizeof (lz -> packetTable));
+
+    if (dictionaryLength > 0)
+      memcpy (lz -> window, dictionary, dictionaryLength);
+
+    /* Later strings replace earlier ones, the end of the dictionary is the closest */
+    for (position = 0; position + ENET_LZ_MINIMUM_MATCH <= dictionaryLength; ++ position)
+      lz -> dictionaryTable [enet_lz_hash (& lz -> window [position])] = (enet_uint16) position;
+
+    return lz;
+}
+
+/** Destroys a codec context.
+    @param context the context to destroy
+*/
+void
+enet_lz_destroy (void * context)
+{
+    ENetLZ * lz = (ENetLZ *) context;
+    if (lz == NULL)
+      return;
+
+    enet_free (lz);
+}
+
+static enet_uint8 *
+enet_lz_write_length (enet_uint8 * outData, size_t length)
+{
+    while (length >= 255)
+    {
+        * outData ++ = 255;
+        length -= 255;
+    }
+    * outData ++ = (enet_uint8) length;
+
+    return outData;
+}
+
+/** Emits one sequence: a token with both lengths, the literals, then the offset and the
+    rest of the match length unless it is the last sequence.
+*/
+static enet_uint8 *
+enet_lz_write_sequence (enet_uint8 * outData, enet_uint8 * outEnd, const enet_uint8 * literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+    size_t extra = matchLength > 0 ? matchLength - ENET_LZ_MINIMUM_MATCH : 0,
+           required = 1 + literalLength;
+    enet_uint8 * token;
+
+    if (literalLength >= ENET_LZ_LENGTH_MASK)
+      required += (literalLength - ENET_LZ_LENGTH_MASK) / 255 + 1;
+    if (matchLength > 0)
+      required += 2 + (extra >= ENET_LZ_LENGTH_MASK ? (extra - ENET_LZ_LENGTH_MASK) / 255 + 1 : 0);
+
+    if (outData == NULL || (size_t) (outEnd - outData) < required)
+      return NULL;
+
+    token = outData ++;
+    * token = (enet_uint8) ((literalLength < ENET_LZ_LENGTH_MASK ? literalLength : ENET_LZ_LENGTH_MASK) << 4);
+    if (literalLength >= ENET_LZ_LENGTH_MASK)
+      outData = enet_lz_write_length (outData, literalLength - ENET_LZ_LENGTH_MASK);
+
+    memcpy (outData, literals, literalLength);
+    outData += literalLength;
+
+    if (matchLength == 0)
+      return outData;
+
+    * outData ++ = (enet_uint8) (offset & 0xFF);
+    * outData ++ = (enet_uint8) (offset >> 8);
+
+    * token |= (enet_uint8) (extra < ENET_LZ_LENGTH_MASK ? extra : ENET_LZ_LENGTH_MASK);
+    if (extra >= ENET_LZ_LENGTH_MASK)
+      outData = enet_lz_write_length (outData, extra - ENET_LZ_LENGTH_MASK);
+
+    return outData;
+}
+
+size_t
+enet_lz_compress (void * context, const ENetBuffer * inBuffers, size_t inBufferCount, size_t inLimit, enet_uint8 * outData, size_t outLimit)
+{
+    ENetLZ * lz = (ENetLZ *) context;
+    enet_uint8 * start = & lz -> window [lz -> dictionaryLength],
+               * outStart = outData,
+               * outEnd = & outData [outLimit];
+    const enet_uint8 * input, * anchor, * inEnd, * matchLimit;
+    size_t length = 0;
+
+    if (inLimit > ENET_PROTOCOL_MAXIMUM_MTU || outLimit < 1)
+      return 0;
+
+    * outData ++ = lz -> dictionaryId;
+
+    while (inBufferCount -- > 0)
+    {
+        size_t bufferLength = inBuffers -> dataLength;
+        if (bufferLength > inLimit - length)
+          bufferLength = inLimit - length;
+
+        memcpy (& start [length], inBuffers -> data, bufferLength);
+        length += bufferLength;
+        ++ inBuffers;
+    }
+
+    /* Strings of the previous packet become stale by moving to the next epoch */
+    if (++ lz -> epoch == 0)
+    {
+        memset (lz -> packetTable, 0, sizeof (lz -> packetTable));
+        lz -> epoch = 1;
+    }
+
+    input = anchor = start;
+    inEnd = & start [length];
+
+    /* Strings are hashed and compared by their first four bytes */
+    matchLimit = length >= ENET_LZ_MINIMUM_MATCH ? inEnd - ENET_LZ_MINIMUM_MATCH + 1 : start;
+
+    while (input < matchLimit)
+    {
+        enet_uint32 hash = enet_lz_hash (input),
+                    entry = lz -> packetTable [hash];
+        const enet_uint8 * reference = NULL;
+        size_t matchLength;
+
+        lz -> packetTable [hash] = ((enet_uint32) lz -> epoch << 16) | (enet_uint32) (input - lz -> window);
+
+        if ((entry >> 16) == lz -> epoch &&
+            enet_lz_read (& lz -> window [entry & 0xFFFF]) == enet_lz_read (input))
+          reference = & lz -> window [entry & 0xFFFF];
+        else
+        if (lz -> dictionaryTable [hash] != ENET_LZ_HASH_EMPTY &&
+            enet_lz_read (& lz -> window [lz -> dictionaryTable [hash]]) == enet_lz_read (input))
+          reference = & lz -> window [lz -> dictionaryTable [hash]];
+
+        if (reference == NULL)
+        {
+            ++ input;
+            continue;
+        }
+
+        matchLength = ENET_LZ_MINIMUM_MATCH;
+        while (& input [matchLength] < inEnd && reference [matchLength] == input [matchLength])
+          ++ matchLength;
+
+        outData = enet_lz_write_sequence (outData, outEnd, anchor, input - anchor, input - reference, matchLength);
+        if (outData == NULL)
+          return 0;
+
+        input += matchLength;
+        anchor = input;
+
+        if (input - 2 < matchLimit)
+          lz -> packetTable [enet_lz_hash (input - 2)] = ((enet_uint32) lz -> epoch << 16) | (enet_uint32) (input - 2 - lz -> window);
+    }
+
+    outData = enet_lz_write_sequence (outData, outEnd, anchor, inEnd - anchor, 0, 0);
+    if (outData == NULL)
+      return 0;
+
+    return (size_t) (outData - outStart);
+}
+
+static int
+enet_lz_read_length (const enet_uint8 ** inData, const enet_uint8 * inEnd, size_t * length)
+{
+    enet_uint8 byte;
+
+    do
+    {
+        if (* inData >= inEnd)
+          return -1;
+
+        byte = * (* inData) ++;
+        * length += byte;
+    } while (byte == 255);
+
+    return 0;
+}
+
+size_t
+enet_lz_decompress (void * context, const enet_uint8 * inData, size_t inLimit, enet_uint8 * outData, size_t outLimit)
+{
+    ENetLZ * lz = (ENetLZ *) context;
+    enet_uint8 * start = & lz -> window [lz -> dictionaryLength],
+               * output = start,
+               * outEnd = & start [outLimit < ENET_PROTOCOL_MAXIMUM_MTU ? outLimit : ENET_PROTOCOL_MAXIMUM_MTU];
+    const enet_uint8 * inEnd = & inData [inLimit],
+                     * base;
+
+    if (inLimit < 1)
+      return 0;
+
+    /* Plain packets must not reach back into the dictionary */
+    if (* inData == 0)
+      base = start;
+    else
+    if (* inData == lz -> dictionaryId)
+      base = lz -> window;
+    else
+      return 0;
+    ++ inData;
+
+    while (inData < inEnd)
+    {
+        enet_uint8 token = * inData ++;
+        size_t literalLength = token >> 4,
+               matchLength = token & ENET_LZ_LENGTH_MASK,
+               offset;
+        const enet_uint8 * reference;
+
+        if (literalLength == ENET_LZ_LENGTH_MASK &&
+            enet_lz_read_length (& inData, inEnd, & literalLength) < 0)
+          return 0;
+
+        if (literalLength > (size_t) (inEnd - inData) || literalLength > (size_t) (outEnd - output))
+          return 0;
+
+        memcpy (output, inData, literalLength);
+        output += literalLength;
+        inData += literalLength;
+
+        if (inData >= inEnd)
+          break;
+
+        if (inEnd - inData < 2)
+          return 0;
+
+        offset = inData [0] | (inData [1] << 8);
+        inData += 2;
+
+        if (matchLength == ENET_LZ_LENGTH_MASK &&
+            enet_lz_read_length (& inData, inEnd, & matchLength) < 0)
+          return 0;
+        matchLength += ENET_LZ_MINIMUM_MATCH;
+
+        if (offset == 0 || offset > (size_t) (output - base) || matchLength > (size_t) (outEnd - output))
+          return 0;
+
+        /* Matches may overlap their own output, e.g. runs of a repeated byte */
+        reference = output - offset;
+        if (offset >= matchLength)
+        {
+            memcpy (output, reference, matchLength);
+            output += matchLength;
+        }
+        else
+        {
+            while (matchLength -- > 0)
+              * output ++ = * reference ++;
+        }
+    }
+
+    memcpy (outData, start, output - start);
+
+    return (size_t) (output - start);
+}
+
+/** @defgroup host ENet host functions
+    @{
+*/
+
+/** Sets the packet compressor the host should use to the LZ codec.
+    @param host host to enable the LZ codec for
+    @param dictionary preset dictionary shared with the remote hosts, may be NULL
+    @param dictionaryLength length of the dictionary
+    @returns 0 on success, < 0 on failure
+*/
+int
+enet_host_compress_with_lz (ENetHost * host, const void * dictionary, size_t dictionaryLength)
+{
+    ENetCompressor compressor;
+    memset (& compressor, 0, sizeof (compressor));
+    compressor.context = enet_lz_create (dictionary, dictionaryLength);
+    if (compressor.context == NULL)
+      return -1;
+    compressor.compress = enet_lz_compress;
+    compressor.decompress = enet_lz_decompress;
+    compressor.destroy = enet_lz_destroy;
+    enet_host_compress (host, & compressor);
+    return 0;
+}
+
+/** @} */
+
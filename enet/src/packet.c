@@ -10,16 +10,10 @@
     @{ 
 */
 
-/** Creates a packet that may be sent to a peer.
-    @param data         initial contents of the packet's data; the packet's data will remain uninitialized if data is NULL.
-    @param dataLength   size of the data allocated for this packet
-    @param flags        flags for this packet as described for the ENetPacket structure.
-    @returns the packet on success, NULL on failure
-*/
-ENetPacket *
-enet_packet_create (const void * data, size_t dataLength, enet_uint32 flags)
+static ENetPacket *
+enet_packet_create_with (ENetAllocator * allocator, const void * data, size_t dataLength, enet_uint32 flags)
 {
-    ENetPacket * packet = (ENetPacket *) enet_malloc (sizeof (ENetPacket));
+    ENetPacket * packet = (ENetPacket *) enet_allocator_malloc (allocator, sizeof (ENetPacket));
     if (packet == NULL)
       return NULL;
 
@@ -30,10 +24,10 @@ enet_packet_create (const void * data, size_t dataLength, enet_uint32 flags)
       packet -> data = NULL;
     else
     {
-       packet -> data = (enet_uint8 *) enet_malloc (dataLength);
+       packet -> data = (enet_uint8 *) enet_allocator_malloc (allocator, dataLength);
        if (packet -> data == NULL)
        {
-          enet_free (packet);
+          enet_allocator_free (allocator, packet, sizeof (ENetPacket));
           return NULL;
        }
 
@@ -46,10 +40,95 @@ enet_packet_create (const void * data, size_t dataLength, enet_uint32 flags)
     packet -> dataLength = dataLength;
     packet -> freeCallback = NULL;
     packet -> userData = NULL;
+    packet -> segments = NULL;
+    packet -> segmentCount = 0;
+    packet -> allocator = allocator;
 
     return packet;
 }
 
+static ENetPacket *
+enet_packet_create_gather_with (ENetAllocator * allocator, const ENetBuffer * buffers, size_t bufferCount, enet_uint32 flags)
+{
+    ENetPacket * packet;
+    size_t dataLength = 0, i;
+
+    packet = (ENetPacket *) enet_allocator_malloc (allocator, sizeof (ENetPacket) + bufferCount * sizeof (ENetBuffer));
+    if (packet == NULL)
+      return NULL;
+
+    packet -> segments = (ENetBuffer *) (packet + 1);
+    packet -> segmentCount = bufferCount;
+
+    for (i = 0; i < bufferCount; ++ i)
+    {
+       packet -> segments [i] = buffers [i];
+       dataLength += buffers [i].dataLength;
+    }
+
+    packet -> referenceCount = 0;
+    packet -> flags = flags | ENET_PACKET_FLAG_NO_ALLOCATE;
+    packet -> data = NULL;
+    packet -> dataLength = dataLength;
+    packet -> freeCallback = NULL;
+    packet -> userData = NULL;
+    packet -> allocator = allocator;
+
+    return packet;
+}
+
+static ENetAllocator *
+enet_host_packet_allocator (ENetHost * host)
+{
+    return host -> allocator.allocate != NULL ? & host -> allocator : NULL;
+}
+
+/** Creates a packet that may be sent to a peer.
+    @param data         initial contents of the packet's data; the packet's data will remain uninitialized if data is NULL.
+    @param dataLength   size of the data allocated for this packet
+    @param flags        flags for this packet as described for the ENetPacket structure.
+    @returns the packet on success, NULL on failure
+*/
+ENetPacket *
+enet_packet_create (const void * data, size_t dataLength, enet_uint32 flags)
+{
+    return enet_packet_create_with (NULL, data, dataLength, flags);
+}
+
+/** Creates a packet whose data is gathered from several user supplied buffers.
+    Only the buffer descriptors are copied, the data itself is sent straight from
+    the buffers, which must stay valid until the packet's freeCallback is called.
+    @param buffers      data segments of the packet, in order
+    @param bufferCount  number of data segments
+    @param flags        flags for this packet as described for the ENetPacket structure.
+    @returns the packet on success, NULL on failure
+*/
+ENetPacket *
+enet_packet_create_gather (const ENetBuffer * buffers, size_t bufferCount, enet_uint32 flags)
+{
+    return enet_packet_create_gather_with (NULL, buffers, bufferCount, flags);
+}
+
+/** Creates a packet from the allocator of a host, see enet_packet_create().
+    @remarks the packet must be destroyed before the host, by the thread servicing the host,
+    and may only be sent to peers of that host
+*/
+ENetPacket *
+enet_host_packet_create (ENetHost * host, const void * data, size_t dataLength, enet_uint32 flags)
+{
+    return enet_packet_create_with (enet_host_packet_allocator (host), data, dataLength, flags);
+}
+
+/** Creates a gathered packet from the allocator of a host, see enet_packet_create_gather().
+    @remarks the packet must be destroyed before the host, by the thread servicing the host,
+    and may only be sent to peers of that host
+*/
+ENetPacket *
+enet_host_packet_create_gather (ENetHost * host, const ENetBuffer * buffers, size_t bufferCount, enet_uint32 flags)
+{
+    return enet_packet_create_gather_with (enet_host_packet_allocator (host), buffers, bufferCount, flags);
+}
+
 /** Destroys the packet and deallocates its data.
     @param packet packet to be destroyed
 */
@@ -63,8 +142,8 @@ enet_packet_destroy (ENetPacket * packet)
       (* packet -> freeCallback) (packet);
     if (! (packet -> flags & ENET_PACKET_FLAG_NO_ALLOCATE) &&
         packet -> data != NULL)
-      enet_free (packet -> data);
-    enet_free (packet);
+      enet_allocator_free (packet -> allocator, packet -> data, packet -> dataLength);
+    enet_allocator_free (packet -> allocator, packet, sizeof (ENetPacket) + packet -> segmentCount * sizeof (ENetBuffer));
 }
 
 /** Attempts to resize the data in the packet to length specified in the 
@@ -72,25 +151,40 @@ enet_packet_destroy (ENetPacket * packet)
     @param packet packet to resize
     @param dataLength new size for the packet data
     @returns 0 on success, < 0 on failure
+    @remarks data of a packet created from a host allocator is reallocated on every size change,
+    allocators are told the size of the memory they release
 */
 int
 enet_packet_resize (ENetPacket * packet, size_t dataLength)
 {
     enet_uint8 * newData;
    
-    if (dataLength <= packet -> dataLength || (packet -> flags & ENET_PACKET_FLAG_NO_ALLOCATE))
+    if (packet -> segments != NULL)
+      return -1;
+
+    if ((packet -> flags & ENET_PACKET_FLAG_NO_ALLOCATE) ||
+        (dataLength <= packet -> dataLength && packet -> allocator == NULL))
     {
        packet -> dataLength = dataLength;
 
        return 0;
     }
 
-    newData = (enet_uint8 *) enet_malloc (dataLength);
-    if (newData == NULL)
-      return -1;
+    if (dataLength == packet -> dataLength)
+      return 0;
 
-    memcpy (newData, packet -> data, packet -> dataLength);
-    enet_free (packet -> data);
+    newData = NULL;
+    if (dataLength > 0)
+    {
+       newData = (enet_uint8 *) enet_allocator_malloc (packet -> allocator, dataLength);
+       if (newData == NULL)
+         return -1;
+
+       memcpy (newData, packet -> data, dataLength < packet -> dataLength ? dataLength : packet -> dataLength);
+    }
+
+    if (packet -> data != NULL)
+      enet_allocator_free (packet -> allocator, packet -> data, packet -> dataLength);
     
     packet -> data = newData;
     packet -> dataLength = dataLength;
@@ -98,8 +192,94 @@ enet_packet_resize (ENetPacket * packet, size_t dataLength)
     return 0;
 }
 
+/** Describes the packet data range [offset, offset + length) as a list of buffers.
+    @param packet   packet which data is described
+    @param offset   offset of the range in the packet data
+    @param length   length of the range
+    @param buffers  destination buffers, may be NULL to only count them
+    @returns the number of buffers covering the range
+*/
+size_t
+enet_packet_gather (const ENetPacket * packet, size_t offset, size_t length, ENetBuffer * buffers)
+{
+    const ENetBuffer * segment;
+    size_t count = 0;
+
+    if (packet -> segments == NULL)
+    {
+       if (buffers != NULL)
+       {
+          buffers -> data = packet -> data + offset;
+          buffers -> dataLength = length;
+       }
+
+       return 1;
+    }
+
+    for (segment = packet -> segments;
+         segment < & packet -> segments [packet -> segmentCount] && length > 0;
+         ++ segment)
+    {
+       size_t segmentLength;
+
+       if (offset >= segment -> dataLength)
+       {
+          offset -= segment -> dataLength;
+
+          continue;
+       }
+
+       segmentLength = segment -> dataLength - offset;
+       if (segmentLength > length)
+         segmentLength = length;
+
+       if (buffers != NULL)
+       {
+          buffers [count].data = (enet_uint8 *) segment -> data + offset;
+          buffers [count].dataLength = segmentLength;
+       }
+
+       ++ count;
+       length -= segmentLength;
+       offset = 0;
+    }
+
+    if (count == 0)
+    {
+       if (buffers != NULL)
+       {
+          buffers -> data = NULL;
+          buffers -> dataLength = 0;
+       }
+
+       return 1;
+    }
+
+    return count;
+}
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ENET_CRC32_PCLMUL 1
+#endif
+
+#ifdef ENET_CRC32_PCLMUL
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ENET_CRC32_PCLMUL_TARGET
+#else
+#include <cpuid.h>
+#define ENET_CRC32_PCLMUL_TARGET __attribute__ ((target ("pclmul,sse4.1")))
+#endif
+#include <wmmintrin.h>
+#include <smmintrin.h>
+#endif
+
 static int initializedCRC32 = 0;
-static enet_uint32 crcTable [256];
+static enet_uint32 crcTable [8][256];
+
+#ifdef ENET_CRC32_PCLMUL
+static int hasPCLMUL = 0;
+#endif
 
 static enet_uint32 
 reflect_crc (int val, int bits)
@@ -118,7 +298,7 @@ reflect_crc (int val, int bits)
 static void 
 initialize_crc32 (void)
 {
-    int byte;
+    int byte, slice;
 
     for (byte = 0; byte < 256; ++ byte)
     {
@@ -133,11 +313,159 @@ initialize_crc32 (void)
                 crc <<= 1;
         }
 
-        crcTable [byte] = reflect_crc (crc, 32);
+        crcTable [0] [byte] = reflect_crc (crc, 32);
+    }
+
+    /* crcTable [slice] advances the CRC of a byte over slice more zero bytes */
+    for (slice = 1; slice < 8; ++ slice)
+    {
+        for (byte = 0; byte < 256; ++ byte)
+        {
+            enet_uint32 crc = crcTable [slice - 1] [byte];
+
+            crcTable [slice] [byte] = (crc >> 8) ^ crcTable [0] [crc & 0xFF];
+        }
+    }
+
+#ifdef ENET_CRC32_PCLMUL
+    {
+#ifdef _MSC_VER
+        int info [4];
+
+        __cpuid (info, 1);
+        hasPCLMUL = (info [2] & (1 << 1)) && (info [2] & (1 << 19));
+#else
+        unsigned int eax, ebx, ecx, edx;
+
+        if (__get_cpuid (1, & eax, & ebx, & ecx, & edx))
+          hasPCLMUL = (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+#endif
     }
+#endif
 
     initializedCRC32 = 1;
 }
+
+/** Slicing-by-8: eight table lookups per eight bytes, independent of the host byte order */
+static enet_uint32
+enet_crc32_slice (enet_uint32 crc, const enet_uint8 * data, size_t length)
+{
+    const enet_uint8 * dataEnd = & data [length];
+
+    for (; length >= 8; length -= 8, data += 8)
+    {
+        crc ^= (enet_uint32) data [0] | ((enet_uint32) data [1] << 8) | ((enet_uint32) data [2] << 16) | ((enet_uint32) data [3] << 24);
+        crc = crcTable [7] [crc & 0xFF] ^
+              crcTable [6] [(crc >> 8) & 0xFF] ^
+              crcTable [5] [(crc >> 16) & 0xFF] ^
+              crcTable [4] [crc >> 24] ^
+              crcTable [3] [data [4]] ^
+              crcTable [2] [data [5]] ^
+              crcTable [1] [data [6]] ^
+              crcTable [0] [data [7]];
+    }
+
+    while (data < dataEnd)
+    {
+        crc = (crc >> 8) ^ crcTable [0] [(crc & 0xFF) ^ *data++];
+    }
+
+    return crc;
+}
+
+#ifdef ENET_CRC32_PCLMUL
+/** Folds 64 byte blocks with carry-less multiplication and reduces the remainder with
+    Barrett's method, see Intel's "Fast CRC Computation for Generic Polynomials Using
+    PCLMULQDQ Instruction". The constants are those of the bit-reflected CRC-32 polynomial.
+    @param length multiple of 16, at least 64
+*/
+static ENET_CRC32_PCLMUL_TARGET enet_uint32
+enet_crc32_fold (enet_uint32 crc, const enet_uint8 * data, size_t length)
+{
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_loadu_si128 ((const __m128i *) (data + 0x00));
+    x2 = _mm_loadu_si128 ((const __m128i *) (data + 0x10));
+    x3 = _mm_loadu_si128 ((const __m128i *) (data + 0x20));
+    x4 = _mm_loadu_si128 ((const __m128i *) (data + 0x30));
+
+    x1 = _mm_xor_si128 (x1, _mm_cvtsi32_si128 ((int) crc));
+    x0 = _mm_set_epi64x (0x01c6e41596LL, 0x0154442bd4LL);
+
+    data += 64;
+    length -= 64;
+
+    /* Four independent lanes hide the latency of the multiplications */
+    while (length >= 64)
+    {
+        x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128 (x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128 (x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128 (x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128 (x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128 (x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128 (x4, x0, 0x11);
+
+        x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x5), _mm_loadu_si128 ((const __m128i *) (data + 0x00)));
+        x2 = _mm_xor_si128 (_mm_xor_si128 (x2, x6), _mm_loadu_si128 ((const __m128i *) (data + 0x10)));
+        x3 = _mm_xor_si128 (_mm_xor_si128 (x3, x7), _mm_loadu_si128 ((const __m128i *) (data + 0x20)));
+        x4 = _mm_xor_si128 (_mm_xor_si128 (x4, x8), _mm_loadu_si128 ((const __m128i *) (data + 0x30)));
+
+        data += 64;
+        length -= 64;
+    }
+
+    /* Lanes fold into one, then the remaining 16 byte blocks */
+    x0 = _mm_set_epi64x (0x00ccaa009eLL, 0x01751997d0LL);
+
+    x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+    x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x4), x5);
+
+    while (length >= 16)
+    {
+        x5 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128 (x1, x0, 0x11);
+        x1 = _mm_xor_si128 (_mm_xor_si128 (x1, _mm_loadu_si128 ((const __m128i *) data)), x5);
+
+        data += 16;
+        length -= 16;
+    }
+
+    /* 128 to 64 bits */
+    x2 = _mm_clmulepi64_si128 (x1, x0, 0x10);
+    x3 = _mm_setr_epi32 (~0, 0, ~0, 0);
+    x1 = _mm_xor_si128 (_mm_srli_si128 (x1, 8), x2);
+
+    x0 = _mm_set_epi64x (0, 0x0163cd6124LL);
+
+    x2 = _mm_srli_si128 (x1, 4);
+    x1 = _mm_and_si128 (x1, x3);
+    x1 = _mm_clmulepi64_si128 (x1, x0, 0x00);
+    x1 = _mm_xor_si128 (x1, x2);
+
+    /* Barrett reduction to 32 bits */
+    x0 = _mm_set_epi64x (0x01f7011641LL, 0x01db710641LL);
+
+    x2 = _mm_and_si128 (x1, x3);
+    x2 = _mm_clmulepi64_si128 (x2, x0, 0x10);
+    x2 = _mm_and_si128 (x2, x3);
+    x2 = _mm_clmulepi64_si128 (x2, x0, 0x00);
+    x1 = _mm_xor_si128 (x1, x2);
+
+    return (enet_uint32) _mm_extract_epi32 (x1, 1);
+}
+#endif
     
 enet_uint32
 enet_crc32 (const ENetBuffer * buffers, size_t bufferCount)
@@ -148,13 +476,21 @@ enet_crc32 (const ENetBuffer * buffers, size_t bufferCount)
 
     while (bufferCount -- > 0)
     {
-        const enet_uint8 * data = (const enet_uint8 *) buffers -> data,
-                         * dataEnd = & data [buffers -> dataLength];
+        const enet_uint8 * data = (const enet_uint8 *) buffers -> data;
+        size_t length = buffers -> dataLength;
 
-        while (data < dataEnd)
+#ifdef ENET_CRC32_PCLMUL
+        if (hasPCLMUL && length >= 64)
         {
-            crc = (crc >> 8) ^ crcTable [(crc & 0xFF) ^ *data++];        
+            size_t folded = length & ~ (size_t) 15;
+
+            crc = enet_crc32_fold (crc, data, folded);
+            data += folded;
+            length -= folded;
         }
+#endif
+
+        crc = enet_crc32_slice (crc, data, length);
 
         ++ buffers;
     }
@@ -5,6 +5,7 @@
 #include <string.h>
 #define ENET_BUILDING_LIB 1
 #include "enet/enet.h"
+#include "enet/time.h"
 
 /** @defgroup peer ENet peer functions 
     @{
@@ -58,6 +59,19 @@ enet_peer_throttle_configure (ENetPeer * peer, enet_uint32 interval, enet_uint32
     enet_peer_queue_outgoing_command (peer, & command, NULL, 0, 0);
 }
 
+/** Overrides the host's packet compressor for the datagrams exchanged with a peer.
+    @param peer peer to compress the datagrams of
+    @param compressor compressor used instead of the host's one, NULL to return to it
+    @remarks the compressor is neither copied nor destroyed, it must outlive its use by
+    the peer, which ends when the peer is reset. A compressor without a compress callback
+    only decompresses, datagrams are then sent uncompressed.
+*/
+void
+enet_peer_compress (ENetPeer * peer, const ENetCompressor * compressor)
+{
+    peer -> compressor = compressor;
+}
+
 int
 enet_peer_throttle (ENetPeer * peer, enet_uint32 rtt)
 {
@@ -89,6 +103,20 @@ enet_peer_throttle (ENetPeer * peer, enet_uint32 rtt)
     return 0;
 }
 
+/** Largest packet which is sent to the peer without fragmentation.
+    @param peer peer to query
+    @returns length of the packet data
+*/
+size_t
+enet_peer_get_fragment_length (const ENetPeer * peer)
+{
+   size_t fragmentLength = peer -> mtu - sizeof (ENetProtocolHeader) - sizeof (ENetProtocolSendFragment);
+   if (peer -> host -> checksum != NULL)
+     fragmentLength -= sizeof(enet_uint32);
+
+   return fragmentLength;
+}
+
 /** Queues a packet to be sent.
     @param peer destination for the packet
     @param channelID channel on which to send
@@ -108,10 +136,7 @@ enet_peer_send (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet)
        packet -> dataLength > peer -> host -> maximumPacketSize)
      return -1;
 
-   fragmentLength = peer -> mtu - sizeof (ENetProtocolHeader) - sizeof (ENetProtocolSendFragment);
-   if (peer -> host -> checksum != NULL)
-     fragmentLength -= sizeof(enet_uint32);
-
+   fragmentLength = enet_peer_get_fragment_length (peer);
    if (packet -> dataLength > fragmentLength)
    {
       enet_uint32 fragmentCount = (packet -> dataLength + fragmentLength - 1) / fragmentLength,
@@ -148,14 +173,14 @@ enet_peer_send (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet)
          if (packet -> dataLength - fragmentOffset < fragmentLength)
            fragmentLength = packet -> dataLength - fragmentOffset;
 
-         fragment = (ENetOutgoingCommand *) enet_malloc (sizeof (ENetOutgoingCommand));
+         fragment = (ENetOutgoingCommand *) enet_allocator_malloc (& peer -> host -> allocator, sizeof (ENetOutgoingCommand));
          if (fragment == NULL)
          {
             while (! enet_list_empty (& fragments))
             {
                fragment = (ENetOutgoingCommand *) enet_list_remove (enet_list_begin (& fragments));
                
-               enet_free (fragment);
+               enet_allocator_free (& peer -> host -> allocator, fragment, sizeof (ENetOutgoingCommand));
             }
             
             return -1;
@@ -213,6 +238,15 @@ enet_peer_send (ENetPeer * peer, enet_uint8 channelID, ENetPacket * packet)
    return 0;
 }
 
+static void
+enet_peer_free_incoming_command (ENetPeer * peer, ENetIncomingCommand * incomingCommand)
+{
+    if (incomingCommand -> fragments != NULL)
+      enet_allocator_free (& peer -> host -> allocator, incomingCommand -> fragments, (incomingCommand -> fragmentCount + 31) / 32 * sizeof (enet_uint32));
+
+    enet_allocator_free (& peer -> host -> allocator, incomingCommand, sizeof (ENetIncomingCommand));
+}
+
 /** Attempts to dequeue any incoming queued packet.
     @param peer peer to dequeue packets from
     @param channelID holds the channel ID of the channel the packet was received on success
@@ -236,10 +270,7 @@ enet_peer_receive (ENetPeer * peer, enet_uint8 * channelID)
 
    -- packet -> referenceCount;
 
-   if (incomingCommand -> fragments != NULL)
-     enet_free (incomingCommand -> fragments);
-
-   enet_free (incomingCommand);
+   enet_peer_free_incoming_command (peer, incomingCommand);
 
    peer -> totalWaitingData -= packet -> dataLength;
 
@@ -247,7 +278,7 @@ enet_peer_receive (ENetPeer * peer, enet_uint8 * channelID)
 }
 
 static void
-enet_peer_reset_outgoing_commands (ENetList * queue)
+enet_peer_reset_outgoing_commands (ENetPeer * peer, ENetList * queue)
 {
     ENetOutgoingCommand * outgoingCommand;
 
@@ -263,12 +294,12 @@ enet_peer_reset_outgoing_commands (ENetList * queue)
             enet_packet_destroy (outgoingCommand -> packet);
        }
 
-       enet_free (outgoingCommand);
+       enet_allocator_free (& peer -> host -> allocator, outgoingCommand, sizeof (ENetOutgoingCommand));
     }
 }
 
 static void
-enet_peer_remove_incoming_commands (ENetList * queue, ENetListIterator startCommand, ENetListIterator endCommand)
+enet_peer_remove_incoming_commands (ENetPeer * peer, ENetList * queue, ENetListIterator startCommand, ENetListIterator endCommand)
 {
     ENetListIterator currentCommand;    
     
@@ -288,17 +319,14 @@ enet_peer_remove_incoming_commands (ENetList * queue, ENetListIterator startComm
             enet_packet_destroy (incomingCommand -> packet);
        }
 
-       if (incomingCommand -> fragments != NULL)
-         enet_free (incomingCommand -> fragments);
-
-       enet_free (incomingCommand);
+       enet_peer_free_incoming_command (peer, incomingCommand);
     }
 }
 
 static void
-enet_peer_reset_incoming_commands (ENetList * queue)
+enet_peer_reset_incoming_commands (ENetPeer * peer, ENetList * queue)
 {
-    enet_peer_remove_incoming_commands(queue, enet_list_begin (queue), enet_list_end (queue));
+    enet_peer_remove_incoming_commands (peer, queue, enet_list_begin (queue), enet_list_end (queue));
 }
  
 void
@@ -314,13 +342,13 @@ enet_peer_reset_queues (ENetPeer * peer)
     }
 
     while (! enet_list_empty (& peer -> acknowledgements))
-      enet_free (enet_list_remove (enet_list_begin (& peer -> acknowledgements)));
+      enet_allocator_free (& peer -> host -> allocator, enet_list_remove (enet_list_begin (& peer -> acknowledgements)), sizeof (ENetAcknowledgement));
 
-    enet_peer_reset_outgoing_commands (& peer -> sentReliableCommands);
-    enet_peer_reset_outgoing_commands (& peer -> sentUnreliableCommands);
-    enet_peer_reset_outgoing_commands (& peer -> outgoingReliableCommands);
-    enet_peer_reset_outgoing_commands (& peer -> outgoingUnreliableCommands);
-    enet_peer_reset_incoming_commands (& peer -> dispatchedCommands);
+    enet_peer_reset_outgoing_commands (peer, & peer -> sentReliableCommands);
+    enet_peer_reset_outgoing_commands (peer, & peer -> sentUnreliableCommands);
+    enet_peer_reset_outgoing_commands (peer, & peer -> outgoingReliableCommands);
+    enet_peer_reset_outgoing_commands (peer, & peer -> outgoingUnreliableCommands);
+    enet_peer_reset_incoming_commands (peer, & peer -> dispatchedCommands);
 
     if (peer -> channels != NULL && peer -> channelCount > 0)
     {
@@ -328,8 +356,8 @@ enet_peer_reset_queues (ENetPeer * peer)
              channel < & peer -> channels [peer -> channelCount];
              ++ channel)
         {
-            enet_peer_reset_incoming_commands (& channel -> incomingReliableCommands);
-            enet_peer_reset_incoming_commands (& channel -> incomingUnreliableCommands);
+            enet_peer_reset_incoming_commands (peer, & channel -> incomingReliableCommands);
+            enet_peer_reset_incoming_commands (peer, & channel -> incomingUnreliableCommands);
         }
 
         enet_free (peer -> channels);
@@ -348,6 +376,7 @@ enet_peer_on_connect (ENetPeer * peer)
           ++ peer -> host -> bandwidthLimitedPeers;
 
         ++ peer -> host -> connectedPeers;
+        enet_list_insert (enet_list_end (& peer -> host -> connectedPeerList), & peer -> connectedList);
     }
 }
 
@@ -360,9 +389,23 @@ enet_peer_on_disconnect (ENetPeer * peer)
           -- peer -> host -> bandwidthLimitedPeers;
 
         -- peer -> host -> connectedPeers;
+        enet_list_remove (& peer -> connectedList);
     }
 }
 
+/** Makes the send pass visit the peer at the deadline, or earlier if it is scheduled earlier already.
+    A deadline which passed makes the peer due at once.
+*/
+void
+enet_peer_schedule (ENetPeer * peer, enet_uint32 deadline)
+{
+    if (peer -> timer.state == ENET_TIMER_STATE_EXPIRED ||
+        (peer -> timer.state == ENET_TIMER_STATE_PENDING && ENET_TIME_LESS_EQUAL (peer -> timer.deadline, deadline)))
+      return;
+
+    enet_timer_wheel_schedule (& peer -> host -> timerWheel, & peer -> timer, deadline);
+}
+
 /** Forcefully disconnects a peer.
     @param peer peer to forcefully disconnect
     @remarks The foreign host represented by the peer is not notified of the disconnection and will timeout
@@ -372,6 +415,8 @@ void
 enet_peer_reset (ENetPeer * peer)
 {
     enet_peer_on_disconnect (peer);
+
+    enet_timer_wheel_cancel (& peer -> host -> timerWheel, & peer -> timer);
         
     peer -> outgoingPeerID = ENET_PROTOCOL_MAXIMUM_PEER_ID;
     peer -> connectID = 0;
@@ -418,6 +463,7 @@ enet_peer_reset (ENetPeer * peer)
     peer -> outgoingUnsequencedGroup = 0;
     peer -> eventData = 0;
     peer -> totalWaitingData = 0;
+    peer -> compressor = NULL;
 
     memset (peer -> unsequencedWindow, 0, sizeof (peer -> unsequencedWindow));
     
@@ -458,6 +504,9 @@ void
 enet_peer_ping_interval (ENetPeer * peer, enet_uint32 pingInterval)
 {
     peer -> pingInterval = pingInterval ? pingInterval : ENET_PEER_PING_INTERVAL;
+
+    if (peer -> state == ENET_PEER_STATE_CONNECTED)
+      enet_peer_schedule (peer, peer -> lastReceiveTime + peer -> pingInterval);
 }
 
 /** Sets the timeout parameters for a peer.
@@ -599,7 +648,7 @@ enet_peer_queue_acknowledgement (ENetPeer * peer, const ENetProtocol * command,
           return NULL;
     }
 
-    acknowledgement = (ENetAcknowledgement *) enet_malloc (sizeof (ENetAcknowledgement));
+    acknowledgement = (ENetAcknowledgement *) enet_allocator_malloc (& peer -> host -> allocator, sizeof (ENetAcknowledgement));
     if (acknowledgement == NULL)
       return NULL;
 
@@ -609,6 +658,8 @@ enet_peer_queue_acknowledgement (ENetPeer * peer, const ENetProtocol * command,
     acknowledgement -> command = * command;
     
     enet_list_insert (enet_list_end (& peer -> acknowledgements), acknowledgement);
+
+    enet_peer_schedule (peer, peer -> host -> serviceTime);
     
     return acknowledgement;
 }
@@ -677,12 +728,14 @@ enet_peer_setup_outgoing_command (ENetPeer * peer, ENetOutgoingCommand * outgoin
       enet_list_insert (enet_list_end (& peer -> outgoingReliableCommands), outgoingCommand);
     else
       enet_list_insert (enet_list_end (& peer -> outgoingUnreliableCommands), outgoingCommand);
+
+    enet_peer_schedule (peer, peer -> host -> serviceTime);
 }
 
 ENetOutgoingCommand *
 enet_peer_queue_outgoing_command (ENetPeer * peer, const ENetProtocol * command, ENetPacket * packet, enet_uint32 offset, enet_uint16 length)
 {
-    ENetOutgoingCommand * outgoingCommand = (ENetOutgoingCommand *) enet_malloc (sizeof (ENetOutgoingCommand));
+    ENetOutgoingCommand * outgoingCommand = (ENetOutgoingCommand *) enet_allocator_malloc (& peer -> host -> allocator, sizeof (ENetOutgoingCommand));
     if (outgoingCommand == NULL)
       return NULL;
 
@@ -778,7 +831,7 @@ enet_peer_dispatch_incoming_unreliable_commands (ENetPeer * peer, ENetChannel *
        droppedCommand = currentCommand;
     }
 
-    enet_peer_remove_incoming_commands (& channel -> incomingUnreliableCommands, enet_list_begin (& channel -> incomingUnreliableCommands), droppedCommand);
+    enet_peer_remove_incoming_commands (peer, & channel -> incomingUnreliableCommands, enet_list_begin (& channel -> incomingUnreliableCommands), droppedCommand);
 }
 
 void
@@ -933,11 +986,11 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
     if (peer -> totalWaitingData >= peer -> host -> maximumWaitingData)
       goto notifyError;
 
-    packet = enet_packet_create (data, dataLength, flags);
+    packet = enet_host_packet_create (peer -> host, data, dataLength, flags);
     if (packet == NULL)
       goto notifyError;
 
-    incomingCommand = (ENetIncomingCommand *) enet_malloc (sizeof (ENetIncomingCommand));
+    incomingCommand = (ENetIncomingCommand *) enet_allocator_malloc (& peer -> host -> allocator, sizeof (ENetIncomingCommand));
     if (incomingCommand == NULL)
       goto notifyError;
 
@@ -952,10 +1005,10 @@ enet_peer_queue_incoming_command (ENetPeer * peer, const ENetProtocol * command,
     if (fragmentCount > 0)
     { 
        if (fragmentCount <= ENET_PROTOCOL_MAXIMUM_FRAGMENT_COUNT)
-         incomingCommand -> fragments = (enet_uint32 *) enet_malloc ((fragmentCount + 31) / 32 * sizeof (enet_uint32));
+         incomingCommand -> fragments = (enet_uint32 *) enet_allocator_malloc (& peer -> host -> allocator, (fragmentCount + 31) / 32 * sizeof (enet_uint32));
        if (incomingCommand -> fragments == NULL)
        {
-          enet_free (incomingCommand);
+          enet_allocator_free (& peer -> host -> allocator, incomingCommand, sizeof (ENetIncomingCommand));
 
           goto notifyError;
        }
@@ -3,6 +3,7 @@
  @brief ENet protocol functions
 */
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #define ENET_BUILDING_LIB 1
 #include "enet/utility.h"
@@ -181,7 +182,7 @@ enet_protocol_remove_sent_unreliable_commands (ENetPeer * peer)
            }
         }
 
-        enet_free (outgoingCommand);
+        enet_allocator_free (& peer -> host -> allocator, outgoingCommand, sizeof (ENetOutgoingCommand));
     }
 }
 
@@ -259,7 +260,7 @@ enet_protocol_remove_sent_reliable_command (ENetPeer * peer, enet_uint16 reliabl
        }
     }
 
-    enet_free (outgoingCommand);
+    enet_allocator_free (& peer -> host -> allocator, outgoingCommand, sizeof (ENetOutgoingCommand));
 
     if (enet_list_empty (& peer -> sentReliableCommands))
       return commandNumber;
@@ -1020,11 +1021,12 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
  
     if (flags & ENET_PROTOCOL_HEADER_FLAG_COMPRESSED)
     {
+        const ENetCompressor * compressor = peer != NULL && peer -> compressor != NULL ? peer -> compressor : & host -> compressor;
         size_t originalSize;
-        if (host -> compressor.context == NULL || host -> compressor.decompress == NULL)
+        if (compressor -> context == NULL || compressor -> decompress == NULL)
           return 0;
 
-        originalSize = host -> compressor.decompress (host -> compressor.context,
+        originalSize = compressor -> decompress (compressor -> context,
                                     host -> receivedData + headerSize, 
                                     host -> receivedDataLength - headerSize, 
                                     host -> packetData [1] + headerSize, 
@@ -1186,17 +1188,136 @@ enet_protocol_handle_incoming_commands (ENetHost * host, ENetEvent * event)
     }
 
 commandError:
+    /* Acknowledgements may have opened the window or moved the retransmit timeout */
+    if (peer != NULL &&
+        peer -> state != ENET_PEER_STATE_DISCONNECTED &&
+        peer -> state != ENET_PEER_STATE_ZOMBIE)
+    {
+        if (! enet_list_empty (& peer -> outgoingReliableCommands))
+          enet_peer_schedule (peer, host -> serviceTime);
+        else
+        if (! enet_list_empty (& peer -> sentReliableCommands))
+          enet_peer_schedule (peer, peer -> nextTimeout);
+    }
+
     if (event != NULL && event -> type != ENET_EVENT_TYPE_NONE)
       return 1;
 
     return 0;
 }
  
+static int
+enet_protocol_receive_datagram (ENetHost * host, ENetEvent * event)
+{
+    host -> totalReceivedData += host -> receivedDataLength;
+    host -> totalReceivedPackets ++;
+
+    if (host -> intercept != NULL)
+    {
+       switch (host -> intercept (host, event))
+       {
+       case 1:
+          if (event != NULL && event -> type != ENET_EVENT_TYPE_NONE)
+            return 1;
+
+          return 0;
+
+       case -1:
+          return -1;
+
+       default:
+          break;
+       }
+    }
+
+    return enet_protocol_handle_incoming_commands (host, event);
+}
+
+static int
+enet_protocol_receive_batch (ENetHost * host, ENetSocketBatch * batch)
+{
+    if (host -> uring != NULL)
+      return enet_uring_receive_batch (host -> uring, batch);
+
+    return enet_socket_receive_batch (host -> socket, batch);
+}
+
+static int
+enet_protocol_send_batch (ENetHost * host, ENetSocketBatch * batch)
+{
+    if (host -> uring != NULL)
+      return enet_uring_send_batch (host -> uring, batch);
+
+    return enet_socket_send_batch (host -> socket, batch);
+}
+
+static int
+enet_protocol_receive_incoming_batches (ENetHost * host, ENetEvent * event)
+{
+    ENetSocketBatch * batch = host -> receiveBatch;
+    size_t packets = 0;
+
+    while (packets < 256)
+    {
+       /* Datagrams left over by an earlier event are handled before receiving more */
+       if (batch -> next >= batch -> count)
+       {
+          int receivedCount = enet_protocol_receive_batch (host, batch);
+
+          if (receivedCount < 0)
+            return -1;
+
+          if (receivedCount == 0)
+            return 0;
+       }
+
+       while (batch -> next < batch -> count)
+       {
+          size_t slot = batch -> next,
+                 length = batch -> lengths [slot],
+                 segmentSize = batch -> segmentSizes [slot];
+
+          if (segmentSize == 0 || segmentSize > length - batch -> offset)
+            segmentSize = length - batch -> offset;
+
+          host -> receivedAddress = batch -> addresses [slot];
+          host -> receivedData = & batch -> data [slot * batch -> slotSize + batch -> offset];
+          host -> receivedDataLength = segmentSize;
+
+          batch -> offset += segmentSize;
+          if (batch -> offset >= length)
+          {
+             batch -> next ++;
+             batch -> offset = 0;
+          }
+
+          ++ packets;
+
+          switch (enet_protocol_receive_datagram (host, event))
+          {
+          case 1:
+             return 1;
+
+          case -1:
+             return -1;
+
+          default:
+             break;
+          }
+       }
+    }
+
+    return 0;
+}
+
 static int
 enet_protocol_receive_incoming_commands (ENetHost * host, ENetEvent * event)
 {
     int packets;
 
+    if (host -> receiveBatch != NULL)
+      return enet_protocol_receive_incoming_batches (host, event);
+
     for (packets = 0; packets < 256; ++ packets)
     {
        int receivedLength;
@@ -1218,29 +1339,8 @@ enet_protocol_receive_incoming_commands (ENetHost * host, ENetEvent * event)
 
        host -> receivedData = host -> packetData [0];
        host -> receivedDataLength = receivedLength;
-      
-       host -> totalReceivedData += receivedLength;
-       host -> totalReceivedPackets ++;
-
-       if (host -> intercept != NULL)
-       {
-          switch (host -> intercept (host, event))
-          {
-          case 1:
-             if (event != NULL && event -> type != ENET_EVENT_TYPE_NONE)
-               return 1;
 
-             continue;
-          
-          case -1:
-             return -1;
-        
-          default:
-             break;
-          }
-       }
-        
-       switch (enet_protocol_handle_incoming_commands (host, event))
+       switch (enet_protocol_receive_datagram (host, event))
        {
        case 1:
           return 1;
@@ -1299,7 +1399,7 @@ enet_protocol_send_acknowledgements (ENetHost * host, ENetPeer * peer)
          enet_protocol_dispatch_state (host, peer, ENET_PEER_STATE_ZOMBIE);
 
        enet_list_remove (& acknowledgement -> acknowledgementList);
-       enet_free (acknowledgement);
+       enet_allocator_free (& host -> allocator, acknowledgement, sizeof (ENetAcknowledgement));
 
        ++ command;
        ++ buffer;
@@ -1321,13 +1421,15 @@ enet_protocol_send_unreliable_outgoing_commands (ENetHost * host, ENetPeer * pee
     
     while (currentCommand != enet_list_end (& peer -> outgoingUnreliableCommands))
     {
-       size_t commandSize;
+       size_t commandSize, dataBuffers;
 
        outgoingCommand = (ENetOutgoingCommand *) currentCommand;
        commandSize = commandSizes [outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK];
+       dataBuffers = outgoingCommand -> packet != NULL ?
+         enet_packet_gather (outgoingCommand -> packet, outgoingCommand -> fragmentOffset, outgoingCommand -> fragmentLength, NULL) : 1;
 
        if (command >= & host -> commands [sizeof (host -> commands) / sizeof (ENetProtocol)] ||
-           buffer + 1 >= & host -> buffers [sizeof (host -> buffers) / sizeof (ENetBuffer)] ||
+           buffer + dataBuffers >= & host -> buffers [sizeof (host -> buffers) / sizeof (ENetBuffer)] ||
            peer -> mtu - host -> packetSize < commandSize ||
            (outgoingCommand -> packet != NULL &&
              peer -> mtu - host -> packetSize < commandSize + outgoingCommand -> fragmentLength))
@@ -1356,7 +1458,7 @@ enet_protocol_send_unreliable_outgoing_commands (ENetHost * host, ENetPeer * pee
                   enet_packet_destroy (outgoingCommand -> packet);
          
                 enet_list_remove (& outgoingCommand -> outgoingCommandList);
-                enet_free (outgoingCommand);
+                enet_allocator_free (& host -> allocator, outgoingCommand, sizeof (ENetOutgoingCommand));
 
                 if (currentCommand == enet_list_end (& peer -> outgoingUnreliableCommands))
                   break;
@@ -1386,15 +1488,14 @@ enet_protocol_send_unreliable_outgoing_commands (ENetHost * host, ENetPeer * pee
        {
           ++ buffer;
           
-          buffer -> data = outgoingCommand -> packet -> data + outgoingCommand -> fragmentOffset;
-          buffer -> dataLength = outgoingCommand -> fragmentLength;
+          buffer += enet_packet_gather (outgoingCommand -> packet, outgoingCommand -> fragmentOffset, outgoingCommand -> fragmentLength, buffer) - 1;
 
-          host -> packetSize += buffer -> dataLength;
+          host -> packetSize += outgoingCommand -> fragmentLength;
 
           enet_list_insert (enet_list_end (& peer -> sentUnreliableCommands), outgoingCommand);
        }
        else
-         enet_free (outgoingCommand);
+         enet_allocator_free (& host -> allocator, outgoingCommand, sizeof (ENetOutgoingCommand));
 
        ++ command;
        ++ buffer;
@@ -1472,7 +1573,7 @@ enet_protocol_send_reliable_outgoing_commands (ENetHost * host, ENetPeer * peer)
     ENetListIterator currentCommand;
     ENetChannel *channel;
     enet_uint16 reliableWindow;
-    size_t commandSize;
+    size_t commandSize, dataBuffers;
     int windowExceeded = 0, windowWrap = 0, canPing = 1;
 
     currentCommand = enet_list_begin (& peer -> outgoingReliableCommands);
@@ -1520,8 +1621,11 @@ enet_protocol_send_reliable_outgoing_commands (ENetHost * host, ENetPeer * peer)
        canPing = 0;
 
        commandSize = commandSizes [outgoingCommand -> command.header.command & ENET_PROTOCOL_COMMAND_MASK];
+       dataBuffers = outgoingCommand -> packet != NULL ?
+         enet_packet_gather (outgoingCommand -> packet, outgoingCommand -> fragmentOffset, outgoingCommand -> fragmentLength, NULL) : 1;
+
        if (command >= & host -> commands [sizeof (host -> commands) / sizeof (ENetProtocol)] ||
-           buffer + 1 >= & host -> buffers [sizeof (host -> buffers) / sizeof (ENetBuffer)] ||
+           buffer + dataBuffers >= & host -> buffers [sizeof (host -> buffers) / sizeof (ENetBuffer)] ||
            peer -> mtu - host -> packetSize < commandSize ||
            (outgoingCommand -> packet != NULL && 
              (enet_uint16) (peer -> mtu - host -> packetSize) < (enet_uint16) (commandSize + outgoingCommand -> fragmentLength)))
@@ -1567,8 +1671,7 @@ enet_protocol_send_reliable_outgoing_commands (ENetHost * host, ENetPeer * peer)
        {
           ++ buffer;
           
-          buffer -> data = outgoingCommand -> packet -> data + outgoingCommand -> fragmentOffset;
-          buffer -> dataLength = outgoingCommand -> fragmentLength;
+          buffer += enet_packet_gather (outgoingCommand -> packet, outgoingCommand -> fragmentOffset, outgoingCommand -> fragmentLength, buffer) - 1;
 
           host -> packetSize += outgoingCommand -> fragmentLength;
 
@@ -1588,154 +1691,243 @@ enet_protocol_send_reliable_outgoing_commands (ENetHost * host, ENetPeer * peer)
 }
 
 static int
-enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int checkForTimeouts)
+enet_protocol_queue_datagram (ENetHost * host, const ENetAddress * address)
+{
+    ENetSocketBatch * batch = host -> sendBatch;
+    const ENetBuffer * buffer;
+    enet_uint8 * slotData;
+    size_t length = 0;
+
+    if (batch -> count >= batch -> capacity &&
+        enet_protocol_send_batch (host, batch) < 0)
+      return -1;
+
+    /* The buffers point at per-peer command storage, so the datagram is copied out */
+    slotData = & batch -> data [batch -> count * batch -> slotSize];
+    for (buffer = host -> buffers; buffer < & host -> buffers [host -> bufferCount]; ++ buffer)
+    {
+        memcpy (& slotData [length], buffer -> data, buffer -> dataLength);
+        length += buffer -> dataLength;
+    }
+
+    batch -> addresses [batch -> count] = * address;
+    batch -> lengths [batch -> count] = length;
+    batch -> count ++;
+
+    return (int) length;
+}
+
+static int
+enet_protocol_send_peer_commands (ENetHost * host, ENetPeer * currentPeer, ENetEvent * event, int checkForTimeouts)
 {
     enet_uint8 headerData [sizeof (ENetProtocolHeader) + sizeof (enet_uint32)];
     ENetProtocolHeader * header = (ENetProtocolHeader *) headerData;
-    ENetPeer * currentPeer;
     int sentLength;
     size_t shouldCompress = 0;
- 
-    host -> continueSending = 1;
+    const ENetCompressor * compressor;
 
-    while (host -> continueSending)
-    for (host -> continueSending = 0,
-           currentPeer = host -> peers;
-         currentPeer < & host -> peers [host -> peerCount];
-         ++ currentPeer)
-    {
-        if (currentPeer -> state == ENET_PEER_STATE_DISCONNECTED ||
-            currentPeer -> state == ENET_PEER_STATE_ZOMBIE)
-          continue;
+    host -> headerFlags = 0;
+    host -> commandCount = 0;
+    host -> bufferCount = 1;
+    host -> packetSize = sizeof (ENetProtocolHeader);
 
-        host -> headerFlags = 0;
-        host -> commandCount = 0;
-        host -> bufferCount = 1;
-        host -> packetSize = sizeof (ENetProtocolHeader);
+    if (! enet_list_empty (& currentPeer -> acknowledgements))
+      enet_protocol_send_acknowledgements (host, currentPeer);
 
-        if (! enet_list_empty (& currentPeer -> acknowledgements))
-          enet_protocol_send_acknowledgements (host, currentPeer);
-
-        if (checkForTimeouts != 0 &&
-            ! enet_list_empty (& currentPeer -> sentReliableCommands) &&
-            ENET_TIME_GREATER_EQUAL (host -> serviceTime, currentPeer -> nextTimeout) &&
-            enet_protocol_check_timeouts (host, currentPeer, event) == 1)
-        {
-            if (event != NULL && event -> type != ENET_EVENT_TYPE_NONE)
-              return 1;
-            else
-              continue;
-        }
+    if (checkForTimeouts != 0 &&
+        ! enet_list_empty (& currentPeer -> sentReliableCommands) &&
+        ENET_TIME_GREATER_EQUAL (host -> serviceTime, currentPeer -> nextTimeout) &&
+        enet_protocol_check_timeouts (host, currentPeer, event) == 1)
+    {
+        if (event != NULL && event -> type != ENET_EVENT_TYPE_NONE)
+          return 1;
+        else
+          return 0;
+    }
 
-        if ((enet_list_empty (& currentPeer -> outgoingReliableCommands) ||
-              enet_protocol_send_reliable_outgoing_commands (host, currentPeer)) &&
-            enet_list_empty (& currentPeer -> sentReliableCommands) &&
-            ENET_TIME_DIFFERENCE (host -> serviceTime, currentPeer -> lastReceiveTime) >= currentPeer -> pingInterval &&
-            currentPeer -> mtu - host -> packetSize >= sizeof (ENetProtocolPing))
-        { 
-            enet_peer_ping (currentPeer);
-            enet_protocol_send_reliable_outgoing_commands (host, currentPeer);
-        }
-                      
-        if (! enet_list_empty (& currentPeer -> outgoingUnreliableCommands))
-          enet_protocol_send_unreliable_outgoing_commands (host, currentPeer);
+    if ((enet_list_empty (& currentPeer -> outgoingReliableCommands) ||
+          enet_protocol_send_reliable_outgoing_commands (host, currentPeer)) &&
+        enet_list_empty (& currentPeer -> sentReliableCommands) &&
+        ENET_TIME_DIFFERENCE (host -> serviceTime, currentPeer -> lastReceiveTime) >= currentPeer -> pingInterval &&
+        currentPeer -> mtu - host -> packetSize >= sizeof (ENetProtocolPing))
+    { 
+        enet_peer_ping (currentPeer);
+        enet_protocol_send_reliable_outgoing_commands (host, currentPeer);
+    }
+                  
+    if (! enet_list_empty (& currentPeer -> outgoingUnreliableCommands))
+      enet_protocol_send_unreliable_outgoing_commands (host, currentPeer);
 
-        if (host -> commandCount == 0)
-          continue;
+    if (host -> commandCount == 0)
+      return 0;
 
-        if (currentPeer -> packetLossEpoch == 0)
-          currentPeer -> packetLossEpoch = host -> serviceTime;
-        else
-        if (ENET_TIME_DIFFERENCE (host -> serviceTime, currentPeer -> packetLossEpoch) >= ENET_PEER_PACKET_LOSS_INTERVAL &&
-            currentPeer -> packetsSent > 0)
-        {
-           enet_uint32 packetLoss = currentPeer -> packetsLost * ENET_PEER_PACKET_LOSS_SCALE / currentPeer -> packetsSent;
+    if (currentPeer -> packetLossEpoch == 0)
+      currentPeer -> packetLossEpoch = host -> serviceTime;
+    else
+    if (ENET_TIME_DIFFERENCE (host -> serviceTime, currentPeer -> packetLossEpoch) >= ENET_PEER_PACKET_LOSS_INTERVAL &&
+        currentPeer -> packetsSent > 0)
+    {
+       enet_uint32 packetLoss = currentPeer -> packetsLost * ENET_PEER_PACKET_LOSS_SCALE / currentPeer -> packetsSent;
 
 #ifdef ENET_DEBUG
-           printf ("peer %u: %f%%+-%f%% packet loss, %u+-%u ms round trip time, %f%% throttle, %u/%u outgoing, %u/%u incoming\n", currentPeer -> incomingPeerID, currentPeer -> packetLoss / (float) ENET_PEER_PACKET_LOSS_SCALE, currentPeer -> packetLossVariance / (float) ENET_PEER_PACKET_LOSS_SCALE, currentPeer -> roundTripTime, currentPeer -> roundTripTimeVariance, currentPeer -> packetThrottle / (float) ENET_PEER_PACKET_THROTTLE_SCALE, enet_list_size (& currentPeer -> outgoingReliableCommands), enet_list_size (& currentPeer -> outgoingUnreliableCommands), currentPeer -> channels != NULL ? enet_list_size (& currentPeer -> channels -> incomingReliableCommands) : 0, currentPeer -> channels != NULL ? enet_list_size (& currentPeer -> channels -> incomingUnreliableCommands) : 0);
+       printf ("peer %u: %f%%+-%f%% packet loss, %u+-%u ms round trip time, %f%% throttle, %u/%u outgoing, %u/%u incoming\n", currentPeer -> incomingPeerID, currentPeer -> packetLoss / (float) ENET_PEER_PACKET_LOSS_SCALE, currentPeer -> packetLossVariance / (float) ENET_PEER_PACKET_LOSS_SCALE, currentPeer -> roundTripTime, currentPeer -> roundTripTimeVariance, currentPeer -> packetThrottle / (float) ENET_PEER_PACKET_THROTTLE_SCALE, enet_list_size (& currentPeer -> outgoingReliableCommands), enet_list_size (& currentPeer -> outgoingUnreliableCommands), currentPeer -> channels != NULL ? enet_list_size (& currentPeer -> channels -> incomingReliableCommands) : 0, currentPeer -> channels != NULL ? enet_list_size (& currentPeer -> channels -> incomingUnreliableCommands) : 0);
 #endif
-          
-           currentPeer -> packetLossVariance -= currentPeer -> packetLossVariance / 4;
+      
+       currentPeer -> packetLossVariance -= currentPeer -> packetLossVariance / 4;
 
-           if (packetLoss >= currentPeer -> packetLoss)
-           {
-              currentPeer -> packetLoss += (packetLoss - currentPeer -> packetLoss) / 8;
-              currentPeer -> packetLossVariance += (packetLoss - currentPeer -> packetLoss) / 4;
-           }
-           else
-           {
-              currentPeer -> packetLoss -= (currentPeer -> packetLoss - packetLoss) / 8;
-              currentPeer -> packetLossVariance += (currentPeer -> packetLoss - packetLoss) / 4;
-           }
+       if (packetLoss >= currentPeer -> packetLoss)
+       {
+          currentPeer -> packetLoss += (packetLoss - currentPeer -> packetLoss) / 8;
+          currentPeer -> packetLossVariance += (packetLoss - currentPeer -> packetLoss) / 4;
+       }
+       else
+       {
+          currentPeer -> packetLoss -= (currentPeer -> packetLoss - packetLoss) / 8;
+          currentPeer -> packetLossVariance += (currentPeer -> packetLoss - packetLoss) / 4;
+       }
 
-           currentPeer -> packetLossEpoch = host -> serviceTime;
-           currentPeer -> packetsSent = 0;
-           currentPeer -> packetsLost = 0;
-        }
+       currentPeer -> packetLossEpoch = host -> serviceTime;
+       currentPeer -> packetsSent = 0;
+       currentPeer -> packetsLost = 0;
+    }
 
-        host -> buffers -> data = headerData;
-        if (host -> headerFlags & ENET_PROTOCOL_HEADER_FLAG_SENT_TIME)
-        {
-            header -> sentTime = ENET_HOST_TO_NET_16 (host -> serviceTime & 0xFFFF);
+    host -> buffers -> data = headerData;
+    if (host -> headerFlags & ENET_PROTOCOL_HEADER_FLAG_SENT_TIME)
+    {
+        header -> sentTime = ENET_HOST_TO_NET_16 (host -> serviceTime & 0xFFFF);
 
-            host -> buffers -> dataLength = sizeof (ENetProtocolHeader);
-        }
-        else
-          host -> buffers -> dataLength = (size_t) & ((ENetProtocolHeader *) 0) -> sentTime;
+        host -> buffers -> dataLength = sizeof (ENetProtocolHeader);
+    }
+    else
+      host -> buffers -> dataLength = (size_t) & ((ENetProtocolHeader *) 0) -> sentTime;
 
-        shouldCompress = 0;
-        if (host -> compressor.context != NULL && host -> compressor.compress != NULL)
+    shouldCompress = 0;
+    compressor = currentPeer -> compressor != NULL ? currentPeer -> compressor : & host -> compressor;
+    if (compressor -> context != NULL && compressor -> compress != NULL)
+    {
+        size_t originalSize = host -> packetSize - sizeof(ENetProtocolHeader),
+               compressedSize = compressor -> compress (compressor -> context,
+                                    & host -> buffers [1], host -> bufferCount - 1,
+                                    originalSize,
+                                    host -> packetData [1],
+                                    originalSize);
+        if (compressedSize > 0 && compressedSize < originalSize)
         {
-            size_t originalSize = host -> packetSize - sizeof(ENetProtocolHeader),
-                   compressedSize = host -> compressor.compress (host -> compressor.context,
-                                        & host -> buffers [1], host -> bufferCount - 1,
-                                        originalSize,
-                                        host -> packetData [1],
-                                        originalSize);
-            if (compressedSize > 0 && compressedSize < originalSize)
-            {
-                host -> headerFlags |= ENET_PROTOCOL_HEADER_FLAG_COMPRESSED;
-                shouldCompress = compressedSize;
+            host -> headerFlags |= ENET_PROTOCOL_HEADER_FLAG_COMPRESSED;
+            shouldCompress = compressedSize;
 #ifdef ENET_DEBUG_COMPRESS
-                printf ("peer %u: compressed %u -> %u (%u%%)\n", currentPeer -> incomingPeerID, originalSize, compressedSize, (compressedSize * 100) / originalSize);
+            printf ("peer %u: compressed %u -> %u (%u%%)\n", currentPeer -> incomingPeerID, originalSize, compressedSize, (compressedSize * 100) / originalSize);
 #endif
-            }
         }
+    }
 
-        if (currentPeer -> outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID)
-          host -> headerFlags |= currentPeer -> outgoingSessionID << ENET_PROTOCOL_HEADER_SESSION_SHIFT;
-        header -> peerID = ENET_HOST_TO_NET_16 (currentPeer -> outgoingPeerID | host -> headerFlags);
-        if (host -> checksum != NULL)
-        {
-            enet_uint32 * checksum = (enet_uint32 *) & headerData [host -> buffers -> dataLength];
-            * checksum = currentPeer -> outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID ? currentPeer -> connectID : 0;
-            host -> buffers -> dataLength += sizeof (enet_uint32);
-            * checksum = host -> checksum (host -> buffers, host -> bufferCount);
-        }
+    if (currentPeer -> outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID)
+      host -> headerFlags |= currentPeer -> outgoingSessionID << ENET_PROTOCOL_HEADER_SESSION_SHIFT;
+    header -> peerID = ENET_HOST_TO_NET_16 (currentPeer -> outgoingPeerID | host -> headerFlags);
+    if (host -> checksum != NULL)
+    {
+        enet_uint32 * checksum = (enet_uint32 *) & headerData [host -> buffers -> dataLength];
+        * checksum = currentPeer -> outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID ? currentPeer -> connectID : 0;
+        host -> buffers -> dataLength += sizeof (enet_uint32);
+        * checksum = host -> checksum (host -> buffers, host -> bufferCount);
+    }
 
-        if (shouldCompress > 0)
-        {
-            host -> buffers [1].data = host -> packetData [1];
-            host -> buffers [1].dataLength = shouldCompress;
-            host -> bufferCount = 2;
-        }
+    if (shouldCompress > 0)
+    {
+        host -> buffers [1].data = host -> packetData [1];
+        host -> buffers [1].dataLength = shouldCompress;
+        host -> bufferCount = 2;
+    }
 
-        currentPeer -> lastSendTime = host -> serviceTime;
+    currentPeer -> lastSendTime = host -> serviceTime;
 
-        sentLength = enet_socket_send (host -> socket, & currentPeer -> address, host -> buffers, host -> bufferCount);
+    if (host -> sendBatch != NULL)
+      sentLength = enet_protocol_queue_datagram (host, & currentPeer -> address);
+    else
+      sentLength = enet_socket_send (host -> socket, & currentPeer -> address, host -> buffers, host -> bufferCount);
 
-        enet_protocol_remove_sent_unreliable_commands (currentPeer);
+    enet_protocol_remove_sent_unreliable_commands (currentPeer);
 
-        if (sentLength < 0)
-          return -1;
+    if (sentLength < 0)
+      return -1;
+
+    host -> totalSentData += sentLength;
+    host -> totalSentPackets ++;
 
-        host -> totalSentData += sentLength;
-        host -> totalSentPackets ++;
-    }
-   
     return 0;
 }
 
+static void
+enet_protocol_schedule_peer (ENetHost * host, ENetPeer * peer)
+{
+    ENetTimerWheel * wheel = & host -> timerWheel;
+    enet_uint32 deadline;
+
+    if (peer -> state == ENET_PEER_STATE_DISCONNECTED ||
+        peer -> state == ENET_PEER_STATE_ZOMBIE)
+      return;
+
+    /* A full datagram went out, the rest of the queues follows in the same pass */
+    if (host -> continueSending)
+    {
+        enet_timer_wheel_schedule (wheel, & peer -> timer, wheel -> time - 1);
+
+        return;
+    }
+
+    /* Work left over waits for the next millisecond, so one pass never loops on a peer */
+    if (! enet_list_empty (& peer -> acknowledgements) ||
+        ! enet_list_empty (& peer -> outgoingUnreliableCommands) ||
+        (enet_list_empty (& peer -> sentReliableCommands) && ! enet_list_empty (& peer -> outgoingReliableCommands)))
+      deadline = wheel -> time;
+    else
+    if (! enet_list_empty (& peer -> sentReliableCommands))
+      deadline = peer -> nextTimeout;
+    else
+    if (peer -> state == ENET_PEER_STATE_CONNECTED)
+      deadline = peer -> lastReceiveTime + peer -> pingInterval;
+    else
+      return;
+
+    if (ENET_TIME_LESS (deadline, wheel -> time))
+      deadline = wheel -> time;
+
+    enet_timer_wheel_schedule (wheel, & peer -> timer, deadline);
+}
+
+static int
+enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int checkForTimeouts)
+{
+    ENetTimerWheel * wheel = & host -> timerWheel;
+    int result = 0;
+
+    /* Only peers with due retransmits, pings or queued commands are visited */
+    enet_timer_wheel_advance (wheel, host -> serviceTime);
+
+    while (result == 0 && ! enet_list_empty (& wheel -> expired))
+    {
+        ENetPeer * currentPeer = (ENetPeer *) ((enet_uint8 *) enet_list_front (& wheel -> expired) - offsetof (ENetPeer, timer));
+
+        enet_timer_wheel_cancel (wheel, & currentPeer -> timer);
+
+        if (currentPeer -> state == ENET_PEER_STATE_DISCONNECTED ||
+            currentPeer -> state == ENET_PEER_STATE_ZOMBIE)
+          continue;
+
+        host -> continueSending = 0;
+
+        result = enet_protocol_send_peer_commands (host, currentPeer, event, checkForTimeouts);
+
+        enet_protocol_schedule_peer (host, currentPeer);
+    }
+
+    if (host -> sendBatch != NULL && host -> sendBatch -> count > 0 &&
+        enet_protocol_send_batch (host, host -> sendBatch) < 0)
+      return -1;
+
+    return result;
+}
+
 /** Sends any queued packets on the host specified to its designated peers.
 
     @param host   host to flush
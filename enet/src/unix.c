@@ -4,6 +4,10 @@
 */
 #ifndef _WIN32
 
+#if defined(__linux__) && ! defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* recvmmsg and sendmmsg */
+#endif
+
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
@@ -48,6 +52,17 @@
 #include <sys/poll.h>
 #endif
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <netinet/udp.h>
+#else
+#include <fcntl.h>
+#endif
+
+#include <poll.h>
+
 #ifndef HAS_SOCKLEN_T
 typedef int socklen_t;
 #endif
@@ -260,6 +275,12 @@ enet_socket_set_option (ENetSocket socket, ENetSocketOption option, int value)
             result = setsockopt (socket, SOL_SOCKET, SO_REUSEADDR, (char *) & value, sizeof (int));
             break;
 
+        case ENET_SOCKOPT_REUSEPORT:
+#ifdef SO_REUSEPORT
+            result = setsockopt (socket, SOL_SOCKET, SO_REUSEPORT, (char *) & value, sizeof (int));
+#endif
+            break;
+
         case ENET_SOCKOPT_RCVBUF:
             result = setsockopt (socket, SOL_SOCKET, SO_RCVBUF, (char *) & value, sizeof (int));
             break;
@@ -290,6 +311,12 @@ enet_socket_set_option (ENetSocket socket, ENetSocketOption option, int value)
             result = setsockopt (socket, IPPROTO_TCP, TCP_NODELAY, (char *) & value, sizeof (int));
             break;
 
+        case ENET_SOCKOPT_UDP_GRO:
+#ifdef UDP_GRO
+            result = setsockopt (socket, IPPROTO_UDP, UDP_GRO, (char *) & value, sizeof (int));
+#endif
+            break;
+
         default:
             break;
     }
@@ -454,6 +481,199 @@ enet_socket_receive (ENetSocket socket,
     return recvLength;
 }
 
+#ifdef __linux__
+
+int
+enet_socket_send_batch (ENetSocket socket, ENetSocketBatch * batch)
+{
+    struct mmsghdr messages [ENET_SOCKET_BATCH_SIZE];
+    struct iovec buffers [ENET_SOCKET_BATCH_SIZE];
+    struct sockaddr_in addresses [ENET_SOCKET_BATCH_SIZE];
+    size_t messageIndex, sentMessages = 0;
+    int sentLength = 0;
+
+    memset (messages, 0, batch -> count * sizeof (struct mmsghdr));
+
+    for (messageIndex = 0; messageIndex < batch -> count; ++ messageIndex)
+    {
+        memset (& addresses [messageIndex], 0, sizeof (struct sockaddr_in));
+        addresses [messageIndex].sin_family = AF_INET;
+        addresses [messageIndex].sin_port = ENET_HOST_TO_NET_16 (batch -> addresses [messageIndex].port);
+        addresses [messageIndex].sin_addr.s_addr = batch -> addresses [messageIndex].host;
+
+        buffers [messageIndex].iov_base = & batch -> data [messageIndex * batch -> slotSize];
+        buffers [messageIndex].iov_len = batch -> lengths [messageIndex];
+
+        messages [messageIndex].msg_hdr.msg_name = & addresses [messageIndex];
+        messages [messageIndex].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+        messages [messageIndex].msg_hdr.msg_iov = & buffers [messageIndex];
+        messages [messageIndex].msg_hdr.msg_iovlen = 1;
+    }
+
+    /* Like enet_socket_send, datagrams which would block are dropped */
+    while (sentMessages < batch -> count)
+    {
+        int sentCount = sendmmsg (socket, & messages [sentMessages], (unsigned int) (batch -> count - sentMessages), MSG_NOSIGNAL);
+
+        if (sentCount < 0)
+        {
+            if (errno == EWOULDBLOCK || errno == EINTR)
+              break;
+
+            batch -> count = 0;
+
+            return -1;
+        }
+
+        for (messageIndex = sentMessages; messageIndex < sentMessages + sentCount; ++ messageIndex)
+          sentLength += (int) messages [messageIndex].msg_len;
+
+        sentMessages += sentCount;
+    }
+
+    batch -> count = 0;
+
+    return sentLength;
+}
+
+int
+enet_socket_receive_batch (ENetSocket socket, ENetSocketBatch * batch)
+{
+    struct mmsghdr messages [ENET_SOCKET_BATCH_SIZE];
+    struct iovec buffers [ENET_SOCKET_BATCH_SIZE];
+    struct sockaddr_in addresses [ENET_SOCKET_BATCH_SIZE];
+    union
+    {
+        char data [CMSG_SPACE (sizeof (int))];
+        struct cmsghdr align;
+    } controls [ENET_SOCKET_BATCH_SIZE];
+    int messageCount, messageIndex;
+
+    batch -> count = 0;
+    batch -> next = 0;
+    batch -> offset = 0;
+
+    memset (messages, 0, batch -> capacity * sizeof (struct mmsghdr));
+
+    for (messageIndex = 0; messageIndex < (int) batch -> capacity; ++ messageIndex)
+    {
+        buffers [messageIndex].iov_base = & batch -> data [messageIndex * batch -> slotSize];
+        buffers [messageIndex].iov_len = batch -> slotSize;
+
+        messages [messageIndex].msg_hdr.msg_name = & addresses [messageIndex];
+        messages [messageIndex].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+        messages [messageIndex].msg_hdr.msg_iov = & buffers [messageIndex];
+        messages [messageIndex].msg_hdr.msg_iovlen = 1;
+        messages [messageIndex].msg_hdr.msg_control = controls [messageIndex].data;
+        messages [messageIndex].msg_hdr.msg_controllen = sizeof (controls [messageIndex].data);
+    }
+
+    messageCount = recvmmsg (socket, messages, (unsigned int) batch -> capacity, MSG_DONTWAIT, NULL);
+
+    if (messageCount < 0)
+    {
+       if (errno == EWOULDBLOCK || errno == EINTR)
+         return 0;
+
+       return -1;
+    }
+
+    for (messageIndex = 0; messageIndex < messageCount; ++ messageIndex)
+    {
+        struct msghdr * msgHdr = & messages [messageIndex].msg_hdr;
+        struct cmsghdr * control;
+
+        if (msgHdr -> msg_flags & MSG_TRUNC)
+          return -1;
+
+        batch -> addresses [messageIndex].host = (enet_uint32) addresses [messageIndex].sin_addr.s_addr;
+        batch -> addresses [messageIndex].port = ENET_NET_TO_HOST_16 (addresses [messageIndex].sin_port);
+        batch -> lengths [messageIndex] = messages [messageIndex].msg_len;
+        batch -> segmentSizes [messageIndex] = 0;
+
+        for (control = CMSG_FIRSTHDR (msgHdr); control != NULL; control = CMSG_NXTHDR (msgHdr, control))
+        {
+#ifdef UDP_GRO
+            if (control -> cmsg_level == IPPROTO_UDP && control -> cmsg_type == UDP_GRO)
+            {
+                int segmentSize;
+
+                memcpy (& segmentSize, CMSG_DATA (control), sizeof (int));
+                batch -> segmentSizes [messageIndex] = (size_t) segmentSize;
+            }
+#endif
+        }
+    }
+
+    batch -> count = (size_t) messageCount;
+
+    return messageCount;
+}
+
+#else
+
+int
+enet_socket_send_batch (ENetSocket socket, ENetSocketBatch * batch)
+{
+    size_t messageIndex;
+    int sentLength = 0;
+
+    for (messageIndex = 0; messageIndex < batch -> count; ++ messageIndex)
+    {
+        ENetBuffer buffer;
+        int length;
+
+        buffer.data = & batch -> data [messageIndex * batch -> slotSize];
+        buffer.dataLength = batch -> lengths [messageIndex];
+
+        length = enet_socket_send (socket, & batch -> addresses [messageIndex], & buffer, 1);
+        if (length < 0)
+        {
+            batch -> count = 0;
+
+            return -1;
+        }
+
+        sentLength += length;
+    }
+
+    batch -> count = 0;
+
+    return sentLength;
+}
+
+int
+enet_socket_receive_batch (ENetSocket socket, ENetSocketBatch * batch)
+{
+    batch -> count = 0;
+    batch -> next = 0;
+    batch -> offset = 0;
+
+    while (batch -> count < batch -> capacity)
+    {
+        ENetBuffer buffer;
+        int length;
+
+        buffer.data = & batch -> data [batch -> count * batch -> slotSize];
+        buffer.dataLength = batch -> slotSize;
+
+        length = enet_socket_receive (socket, & batch -> addresses [batch -> count], & buffer, 1);
+        if (length < 0)
+          return -1;
+
+        if (length == 0)
+          break;
+
+        batch -> lengths [batch -> count] = (size_t) length;
+        batch -> segmentSizes [batch -> count] = 0;
+        batch -> count ++;
+    }
+
+    return (int) batch -> count;
+}
+
+#endif
+
 int
 enet_socketset_select (ENetSocket maxSocket, ENetSocketSet * readSet, ENetSocketSet * writeSet, enet_uint32 timeout)
 {
@@ -468,7 +688,7 @@ enet_socketset_select (ENetSocket maxSocket, ENetSocketSet * readSet, ENetSocket
 int
 enet_socket_wait (ENetSocket socket, enet_uint32 * condition, enet_uint32 timeout)
 {
-#ifdef HAS_POLL
+#if defined(HAS_POLL) || defined(__linux__)
     struct pollfd pollSocket;
     int pollCount;
     
@@ -553,5 +773,472 @@ enet_socket_wait (ENetSocket socket, enet_uint32 * condition, enet_uint32 timeou
 #endif
 }
 
+int
+enet_host_waiter_create (ENetHostWaiter * waiter, ENetSocket socket)
+{
+#ifdef __linux__
+    struct epoll_event event;
+
+    waiter -> wakeup [0] = waiter -> wakeup [1] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (waiter -> wakeup [0] < 0)
+      return -1;
+
+    waiter -> poll = epoll_create1 (EPOLL_CLOEXEC);
+    if (waiter -> poll < 0)
+    {
+        close (waiter -> wakeup [0]);
+
+        return -1;
+    }
+
+    memset (& event, 0, sizeof (struct epoll_event));
+    event.events = EPOLLIN;
+    event.data.fd = socket;
+
+    if (epoll_ctl (waiter -> poll, EPOLL_CTL_ADD, socket, & event) < 0)
+    {
+        enet_host_waiter_destroy (waiter);
+
+        return -1;
+    }
+
+    event.data.fd = waiter -> wakeup [0];
+
+    if (epoll_ctl (waiter -> poll, EPOLL_CTL_ADD, waiter -> wakeup [0], & event) < 0)
+    {
+        enet_host_waiter_destroy (waiter);
+
+        return -1;
+    }
+#else
+    waiter -> poll = -1;
+
+    if (pipe (waiter -> wakeup) < 0)
+      return -1;
+
+    fcntl (waiter -> wakeup [0], F_SETFL, O_NONBLOCK | fcntl (waiter -> wakeup [0], F_GETFL));
+    fcntl (waiter -> wakeup [1], F_SETFL, O_NONBLOCK | fcntl (waiter -> wakeup [1], F_GETFL));
+#endif
+
+    return 0;
+}
+
+void
+enet_host_waiter_destroy (ENetHostWaiter * waiter)
+{
+    if (waiter -> poll >= 0)
+      close (waiter -> poll);
+
+    close (waiter -> wakeup [0]);
+    if (waiter -> wakeup [1] != waiter -> wakeup [0])
+      close (waiter -> wakeup [1]);
+}
+
+int
+enet_host_waiter_wait (ENetHostWaiter * waiter, ENetSocket socket, enet_uint32 timeout)
+{
+#ifdef __linux__
+    struct epoll_event events [2];
+    int eventCount, eventIndex;
+    eventfd_t signals;
+
+    /* the socket is registered with the epoll set, only the poll fallback needs it */
+    (void) socket;
+
+    eventCount = epoll_wait (waiter -> poll, events, 2, (int) timeout);
+    if (eventCount < 0)
+      return errno == EINTR ? 1 : -1;
+
+    for (eventIndex = 0; eventIndex < eventCount; ++ eventIndex)
+    {
+        if (events [eventIndex].data.fd == waiter -> wakeup [0])
+          eventfd_read (waiter -> wakeup [0], & signals);
+    }
+
+    return eventCount;
+#else
+    struct pollfd pollSockets [2];
+    enet_uint8 drain [64];
+    int pollCount;
+
+    pollSockets [0].fd = socket;
+    pollSockets [0].events = POLLIN;
+    pollSockets [0].revents = 0;
+    pollSockets [1].fd = waiter -> wakeup [0];
+    pollSockets [1].events = POLLIN;
+    pollSockets [1].revents = 0;
+
+    pollCount = poll (pollSockets, 2, (int) timeout);
+    if (pollCount < 0)
+      return errno == EINTR ? 1 : -1;
+
+    if (pollSockets [1].revents & POLLIN)
+    {
+        while (read (waiter -> wakeup [0], drain, sizeof (drain)) > 0)
+          ;
+    }
+
+    return pollCount;
+#endif
+}
+
+void
+enet_host_waiter_wake (ENetHostWaiter * waiter)
+{
+#ifdef __linux__
+    eventfd_write (waiter -> wakeup [1], 1);
+#else
+    enet_uint8 signal = 1;
+
+    write (waiter -> wakeup [1], & signal, sizeof (enet_uint8));
+#endif
+}
+
+typedef struct _ENetWaitEntry
+{
+    ENetListNode node;
+    ENetHost *   host;      /**< NULL for an application socket */
+    ENetSocket   socket;
+    void *       data;
+    int          ready;
+} ENetWaitEntry;
+
+struct _ENetWaitSet
+{
+    ENetList         entries;
+#ifdef __linux__
+    int              poll;    /**< epoll instance watching host waiters, sockets and the timer */
+    int              timer;   /**< timerfd armed for the earliest ENet timer of the hosts */
+#else
+    struct pollfd *  pollSockets;
+    ENetWaitEntry ** pollEntries;
+    size_t           pollCapacity;
+#endif
+};
+
+enum
+{
+    ENET_WAITSET_READY_EVENTS = 64
+};
+
+/** Creates an empty wait set.
+
+    A thread which services many hosts sleeps on all of them at once with
+    enet_waitset_wait(). On Linux the set is an epoll instance and the ENet
+    timers of the hosts arm a timerfd, so a wait costs the same for any
+    number of hosts. Elsewhere it falls back to poll().
+*/
+ENetWaitSet *
+enet_waitset_create (void)
+{
+    ENetWaitSet * set = (ENetWaitSet *) enet_malloc (sizeof (ENetWaitSet));
+    if (set == NULL)
+      return NULL;
+    memset (set, 0, sizeof (ENetWaitSet));
+
+    enet_list_clear (& set -> entries);
+
+#ifdef __linux__
+    {
+        struct epoll_event event;
+
+        set -> poll = epoll_create1 (EPOLL_CLOEXEC);
+        set -> timer = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+        memset (& event, 0, sizeof (struct epoll_event));
+        event.events = EPOLLIN;
+        event.data.ptr = NULL;
+
+        if (set -> poll < 0 || set -> timer < 0 ||
+            epoll_ctl (set -> poll, EPOLL_CTL_ADD, set -> timer, & event) < 0)
+        {
+            enet_waitset_destroy (set);
+
+            return NULL;
+        }
+    }
+#endif
+
+    return set;
+}
+
+void
+enet_waitset_destroy (ENetWaitSet * set)
+{
+    if (set == NULL)
+      return;
+
+    while (! enet_list_empty (& set -> entries))
+      enet_free (enet_list_remove (enet_list_begin (& set -> entries)));
+
+#ifdef __linux__
+    if (set -> poll >= 0)
+      close (set -> poll);
+
+    if (set -> timer >= 0)
+      close (set -> timer);
+#else
+    if (set -> pollSockets != NULL)
+      enet_free (set -> pollSockets);
+
+    if (set -> pollEntries != NULL)
+      enet_free (set -> pollEntries);
+#endif
+
+    enet_free (set);
+}
+
+static int
+enet_waitset_add (ENetWaitSet * set, ENetHost * host, ENetSocket socket, void * data)
+{
+    ENetWaitEntry * entry = (ENetWaitEntry *) enet_malloc (sizeof (ENetWaitEntry));
+    if (entry == NULL)
+      return -1;
+
+    entry -> host = host;
+    entry -> socket = socket;
+    entry -> data = data;
+    entry -> ready = 0;
+
+#ifdef __linux__
+    {
+        struct epoll_event event;
+
+        memset (& event, 0, sizeof (struct epoll_event));
+        event.events = EPOLLIN;
+        event.data.ptr = entry;
+
+        /* The waiter epoll of a host is readable when its socket, its io_uring or enet_host_wake() is */
+        if (epoll_ctl (set -> poll, EPOLL_CTL_ADD, host != NULL ? host -> waiter.poll : socket, & event) < 0)
+        {
+            enet_free (entry);
+
+            return -1;
+        }
+    }
+#endif
+
+    enet_list_insert (enet_list_end (& set -> entries), entry);
+
+    return 0;
+}
+
+static void
+enet_waitset_remove_entry (ENetWaitSet * set, ENetHost * host, ENetSocket socket)
+{
+    ENetListIterator currentEntry;
+
+    for (currentEntry = enet_list_begin (& set -> entries);
+         currentEntry != enet_list_end (& set -> entries);
+         currentEntry = enet_list_next (currentEntry))
+    {
+       ENetWaitEntry * entry = (ENetWaitEntry *) currentEntry;
+
+       if (entry -> host != host || (host == NULL && entry -> socket != socket))
+         continue;
+
+#ifdef __linux__
+       epoll_ctl (set -> poll, EPOLL_CTL_DEL, host != NULL ? host -> waiter.poll : socket, NULL);
+#endif
+
+       enet_list_remove (currentEntry);
+       enet_free (entry);
+
+       return;
+    }
+}
+
+/** Adds a host to the wait set, it is reported when it has to be serviced. */
+int
+enet_waitset_add_host (ENetWaitSet * set, ENetHost * host, void * data)
+{
+    return enet_waitset_add (set, host, host -> socket, data);
+}
+
+void
+enet_waitset_remove_host (ENetWaitSet * set, ENetHost * host)
+{
+    enet_waitset_remove_entry (set, host, host -> socket);
+}
+
+/** Adds an application socket or other descriptor, it is reported while it is readable. */
+int
+enet_waitset_add_socket (ENetWaitSet * set, ENetSocket socket, void * data)
+{
+    return enet_waitset_add (set, NULL, socket, data);
+}
+
+void
+enet_waitset_remove_socket (ENetWaitSet * set, ENetSocket socket)
+{
+    enet_waitset_remove_entry (set, NULL, socket);
+}
+
+static enet_uint32
+enet_waitset_get_timeout (ENetWaitSet * set, enet_uint32 timeout)
+{
+    ENetListIterator currentEntry;
+
+    for (currentEntry = enet_list_begin (& set -> entries);
+         currentEntry != enet_list_end (& set -> entries) && timeout > 0;
+         currentEntry = enet_list_next (currentEntry))
+    {
+       ENetWaitEntry * entry = (ENetWaitEntry *) currentEntry;
+
+       if (entry -> host != NULL)
+         timeout = enet_host_get_timeout (entry -> host, timeout);
+    }
+
+    return timeout;
+}
+
+static size_t
+enet_waitset_report (ENetWaitSet * set, ENetWaitEvent * events, size_t eventCount)
+{
+    ENetListIterator currentEntry;
+    size_t eventIndex = 0;
+
+    for (currentEntry = enet_list_begin (& set -> entries);
+         currentEntry != enet_list_end (& set -> entries);
+         currentEntry = enet_list_next (currentEntry))
+    {
+       ENetWaitEntry * entry = (ENetWaitEntry *) currentEntry;
+       int ready = entry -> ready;
+
+       /* Hosts are also due when an ENet timer expired or received datagrams are left */
+       if (! ready && entry -> host != NULL)
+         ready = enet_host_get_timeout (entry -> host, 1) == 0;
+
+       if (! ready || eventIndex >= eventCount)
+         continue;
+
+       /* Drains the wakeups of the host, unreported ones stay signalled */
+       if (entry -> ready && entry -> host != NULL)
+         enet_host_waiter_wait (& entry -> host -> waiter, entry -> socket, 0);
+
+       entry -> ready = 0;
+
+       events [eventIndex].host = entry -> host;
+       events [eventIndex].socket = entry -> socket;
+       events [eventIndex].data = entry -> data;
+       ++ eventIndex;
+    }
+
+    return eventIndex;
+}
+
+/** Sleeps until a host of the set has to be serviced, an application socket is readable or the timeout expires.
+
+    @param set        wait set to sleep on
+    @param events     receives the hosts and sockets which are ready
+    @param eventCount size of the events array, the rest is reported by the next call
+    @param timeout    number of milliseconds to wait at most
+    @retval > 0 number of reported events
+    @retval 0 if the timeout expired
+    @retval < 0 on failure
+    @remarks enet_host_wake() on a host of the set interrupts the wait and reports the host
+*/
+int
+enet_waitset_wait (ENetWaitSet * set, ENetWaitEvent * events, size_t eventCount, enet_uint32 timeout)
+{
+#ifdef __linux__
+    struct epoll_event readyEvents [ENET_WAITSET_READY_EVENTS];
+    struct itimerspec timerSpec;
+    int readyCount, readyIndex;
+
+    /* A zero timeout disarms the timer, epoll then only picks up what is ready */
+    timeout = enet_waitset_get_timeout (set, timeout);
+
+    memset (& timerSpec, 0, sizeof (struct itimerspec));
+    timerSpec.it_value.tv_sec = timeout / 1000;
+    timerSpec.it_value.tv_nsec = (timeout % 1000) * 1000000;
+
+    if (timerfd_settime (set -> timer, 0, & timerSpec, NULL) < 0)
+      return -1;
+
+    readyCount = epoll_wait (set -> poll, readyEvents, ENET_WAITSET_READY_EVENTS, timeout > 0 ? -1 : 0);
+    if (readyCount < 0)
+      return errno == EINTR ? 0 : -1;
+
+    for (readyIndex = 0; readyIndex < readyCount; ++ readyIndex)
+    {
+        ENetWaitEntry * entry = (ENetWaitEntry *) readyEvents [readyIndex].data.ptr;
+
+        if (entry != NULL)
+          entry -> ready = 1;
+        else
+        {
+            enet_uint8 expirations [8];
+
+            read (set -> timer, expirations, sizeof (expirations));
+        }
+    }
+#else
+    ENetListIterator currentEntry;
+    size_t pollCount = 0, pollIndex;
+    int readyCount;
+
+    if (set -> pollCapacity < enet_list_size (& set -> entries) * 2)
+    {
+        size_t capacity = enet_list_size (& set -> entries) * 2;
+        struct pollfd * pollSockets = (struct pollfd *) enet_malloc (capacity * sizeof (struct pollfd));
+        ENetWaitEntry ** pollEntries = (ENetWaitEntry **) enet_malloc (capacity * sizeof (ENetWaitEntry *));
+
+        if (pollSockets == NULL || pollEntries == NULL)
+        {
+            if (pollSockets != NULL)
+              enet_free (pollSockets);
+
+            if (pollEntries != NULL)
+              enet_free (pollEntries);
+
+            return -1;
+        }
+
+        if (set -> pollSockets != NULL)
+          enet_free (set -> pollSockets);
+
+        if (set -> pollEntries != NULL)
+          enet_free (set -> pollEntries);
+
+        set -> pollSockets = pollSockets;
+        set -> pollEntries = pollEntries;
+        set -> pollCapacity = capacity;
+    }
+
+    for (currentEntry = enet_list_begin (& set -> entries);
+         currentEntry != enet_list_end (& set -> entries);
+         currentEntry = enet_list_next (currentEntry))
+    {
+       ENetWaitEntry * entry = (ENetWaitEntry *) currentEntry;
+
+       set -> pollSockets [pollCount].fd = entry -> socket;
+       set -> pollSockets [pollCount].events = POLLIN;
+       set -> pollSockets [pollCount].revents = 0;
+       set -> pollEntries [pollCount ++] = entry;
+
+       if (entry -> host == NULL)
+         continue;
+
+       set -> pollSockets [pollCount].fd = entry -> host -> waiter.wakeup [0];
+       set -> pollSockets [pollCount].events = POLLIN;
+       set -> pollSockets [pollCount].revents = 0;
+       set -> pollEntries [pollCount ++] = entry;
+    }
+
+    readyCount = poll (set -> pollSockets, pollCount, (int) enet_waitset_get_timeout (set, timeout));
+    if (readyCount < 0)
+      return errno == EINTR ? 0 : -1;
+
+    for (pollIndex = 0; pollIndex < pollCount; ++ pollIndex)
+    {
+        if (set -> pollSockets [pollIndex].revents & (POLLIN | POLLERR | POLLHUP))
+          set -> pollEntries [pollIndex] -> ready = 1;
+    }
+#endif
+
+    return (int) enet_waitset_report (set, events, eventCount);
+}
+
 #endif
 
@@ -0,0 +1,477 @@
+/**
+ @file  uring.c
+ @brief ENet io_uring socket backend for Linux
+*/
+#define ENET_BUILDING_LIB 1
+#include "enet/enet.h"
+
+#ifdef __linux__
+
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <netinet/in.h>
+#include <linux/io_uring.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+enum
+{
+   ENET_URING_SEND_ENTRIES     = ENET_SOCKET_BATCH_SIZE,
+   ENET_URING_RECEIVE_ENTRIES  = 4,
+   ENET_URING_BUFFER_COUNT     = 256,     /**< provided receive buffers, a power of two */
+   ENET_URING_BUFFER_SIZE      = sizeof (struct io_uring_recvmsg_out) + sizeof (struct sockaddr_in) + ENET_PROTOCOL_MAXIMUM_MTU,
+   ENET_URING_BUFFER_GROUP     = 0
+};
+
+typedef struct _ENetUringQueue
+{
+   int                   fd;
+   void *                sqRing;
+   size_t                sqRingSize;
+   void *                cqRing;
+   size_t                cqRingSize;
+   struct io_uring_sqe * sqes;
+   size_t                sqesSize;
+   unsigned *            sqHead;
+   unsigned *            sqTail;
+   unsigned *            sqArray;
+   unsigned              sqMask;
+   unsigned              sqEntries;
+   unsigned *            cqHead;
+   unsigned *            cqTail;
+   unsigned              cqMask;
+   struct io_uring_cqe * cqes;
+} ENetUringQueue;
+
+struct _ENetUring
+{
+   ENetSocket                 socket;
+   ENetUringQueue             receive;
+   ENetUringQueue             send;
+   struct io_uring_buf_ring * bufferRing;
+   size_t                     bufferRingSize;
+   enet_uint16                bufferTail;
+   enet_uint8 *               buffers;
+   struct msghdr              receiveHeader;
+   int                        receiveArmed;
+   struct msghdr              sendHeaders [ENET_SOCKET_BATCH_SIZE];
+   struct iovec               sendBuffers [ENET_SOCKET_BATCH_SIZE];
+   struct sockaddr_in         sendAddresses [ENET_SOCKET_BATCH_SIZE];
+};
+
+static int
+enet_uring_queue_create (ENetUringQueue * queue, unsigned entries, unsigned completions)
+{
+    struct io_uring_params params;
+    enet_uint8 * sqRing, * cqRing;
+
+    memset (queue, 0, sizeof (ENetUringQueue));
+    memset (& params, 0, sizeof (struct io_uring_params));
+
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = completions;
+
+    queue -> fd = (int) syscall (__NR_io_uring_setup, entries, & params);
+    if (queue -> fd < 0)
+      return -1;
+
+    queue -> sqRingSize = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+    queue -> cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (queue -> cqRingSize > queue -> sqRingSize)
+          queue -> sqRingSize = queue -> cqRingSize;
+
+        queue -> cqRingSize = 0;
+    }
+
+    queue -> sqRing = mmap (NULL, queue -> sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, queue -> fd, IORING_OFF_SQ_RING);
+    if (queue -> sqRing == MAP_FAILED)
+    {
+        queue -> sqRing = NULL;
+
+        return -1;
+    }
+
+    if (queue -> cqRingSize == 0)
+      queue -> cqRing = queue -> sqRing;
+    else
+    {
+        queue -> cqRing = mmap (NULL, queue -> cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, queue -> fd, IORING_OFF_CQ_RING);
+        if (queue -> cqRing == MAP_FAILED)
+        {
+            queue -> cqRing = NULL;
+
+            return -1;
+        }
+    }
+
+    queue -> sqesSize = params.sq_entries * sizeof (struct io_uring_sqe);
+    queue -> sqes = (struct io_uring_sqe *) mmap (NULL, queue -> sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, queue -> fd, IORING_OFF_SQES);
+    if (queue -> sqes == MAP_FAILED)
+    {
+        queue -> sqes = NULL;
+
+        return -1;
+    }
+
+    sqRing = (enet_uint8 *) queue -> sqRing;
+    cqRing = (enet_uint8 *) queue -> cqRing;
+
+    queue -> sqHead = (unsigned *) (sqRing + params.sq_off.head);
+    queue -> sqTail = (unsigned *) (sqRing + params.sq_off.tail);
+    queue -> sqArray = (unsigned *) (sqRing + params.sq_off.array);
+    queue -> sqMask = * (unsigned *) (sqRing + params.sq_off.ring_mask);
+    queue -> sqEntries = params.sq_entries;
+
+    queue -> cqHead = (unsigned *) (cqRing + params.cq_off.head);
+    queue -> cqTail = (unsigned *) (cqRing + params.cq_off.tail);
+    queue -> cqMask = * (unsigned *) (cqRing + params.cq_off.ring_mask);
+    queue -> cqes = (struct io_uring_cqe *) (cqRing + params.cq_off.cqes);
+
+    return 0;
+}
+
+static void
+enet_uring_queue_destroy (ENetUringQueue * queue)
+{
+    if (queue -> sqes != NULL)
+      munmap (queue -> sqes, queue -> sqesSize);
+
+    if (queue -> cqRing != NULL && queue -> cqRing != queue -> sqRing)
+      munmap (queue -> cqRing, queue -> cqRingSize);
+
+    if (queue -> sqRing != NULL)
+      munmap (queue -> sqRing, queue -> sqRingSize);
+
+    if (queue -> fd > 0)
+      close (queue -> fd);
+}
+
+static struct io_uring_sqe *
+enet_uring_queue_get (ENetUringQueue * queue)
+{
+    unsigned tail = * queue -> sqTail,
+             head = __atomic_load_n (queue -> sqHead, __ATOMIC_ACQUIRE);
+    struct io_uring_sqe * sqe;
+
+    if (tail - head >= queue -> sqEntries)
+      return NULL;
+
+    sqe = & queue -> sqes [tail & queue -> sqMask];
+    memset (sqe, 0, sizeof (struct io_uring_sqe));
+
+    queue -> sqArray [tail & queue -> sqMask] = tail & queue -> sqMask;
+    __atomic_store_n (queue -> sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    return sqe;
+}
+
+static int
+enet_uring_queue_enter (ENetUringQueue * queue, unsigned submitCount, unsigned waitCount)
+{
+    int result;
+
+    do
+    {
+        result = (int) syscall (__NR_io_uring_enter, queue -> fd, submitCount, waitCount,
+                                waitCount > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    }
+    while (result < 0 && errno == EINTR);
+
+    return result;
+}
+
+static void
+enet_uring_recycle (ENetUring * uring, enet_uint16 bufferID)
+{
+    struct io_uring_buf * buffer = & uring -> bufferRing -> bufs [uring -> bufferTail & (ENET_URING_BUFFER_COUNT - 1)];
+
+    buffer -> addr = (__u64) (size_t) & uring -> buffers [bufferID * ENET_URING_BUFFER_SIZE];
+    buffer -> len = ENET_URING_BUFFER_SIZE;
+    buffer -> bid = bufferID;
+
+    ++ uring -> bufferTail;
+}
+
+static void
+enet_uring_publish (ENetUring * uring)
+{
+    __atomic_store_n (& uring -> bufferRing -> tail, uring -> bufferTail, __ATOMIC_RELEASE);
+}
+
+/* One multishot receive keeps posting completions until it runs out of buffers */
+static int
+enet_uring_arm (ENetUring * uring)
+{
+    struct io_uring_sqe * sqe = enet_uring_queue_get (& uring -> receive);
+    if (sqe == NULL)
+      return -1;
+
+    sqe -> opcode = IORING_OP_RECVMSG;
+    sqe -> fd = uring -> socket;
+    sqe -> addr = (__u64) (size_t) & uring -> receiveHeader;
+    sqe -> len = 1;
+    sqe -> ioprio = IORING_RECV_MULTISHOT;
+    sqe -> flags = IOSQE_BUFFER_SELECT;
+    sqe -> buf_group = ENET_URING_BUFFER_GROUP;
+
+    if (enet_uring_queue_enter (& uring -> receive, 1, 0) < 0)
+      return -1;
+
+    uring -> receiveArmed = 1;
+
+    return 0;
+}
+
+ENetUring *
+enet_uring_create (ENetSocket socket, ENetHostWaiter * waiter)
+{
+    struct io_uring_buf_reg bufferReg;
+    ENetUring * uring;
+    enet_uint16 bufferID;
+
+    uring = (ENetUring *) enet_malloc (sizeof (ENetUring));
+    if (uring == NULL)
+      return NULL;
+    memset (uring, 0, sizeof (ENetUring));
+
+    uring -> socket = socket;
+    uring -> receiveHeader.msg_namelen = sizeof (struct sockaddr_in);
+
+    if (enet_uring_queue_create (& uring -> receive, ENET_URING_RECEIVE_ENTRIES, ENET_URING_BUFFER_COUNT * 2) < 0 ||
+        enet_uring_queue_create (& uring -> send, ENET_URING_SEND_ENTRIES, ENET_URING_SEND_ENTRIES * 2) < 0)
+      goto failure;
+
+    uring -> buffers = (enet_uint8 *) enet_malloc (ENET_URING_BUFFER_COUNT * ENET_URING_BUFFER_SIZE);
+    if (uring -> buffers == NULL)
+      goto failure;
+
+    uring -> bufferRingSize = ENET_URING_BUFFER_COUNT * sizeof (struct io_uring_buf);
+    uring -> bufferRing = (struct io_uring_buf_ring *) mmap (NULL, uring -> bufferRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (uring -> bufferRing == MAP_FAILED)
+    {
+        uring -> bufferRing = NULL;
+
+        goto failure;
+    }
+
+    memset (& bufferReg, 0, sizeof (struct io_uring_buf_reg));
+    bufferReg.ring_addr = (__u64) (size_t) uring -> bufferRing;
+    bufferReg.ring_entries = ENET_URING_BUFFER_COUNT;
+    bufferReg.bgid = ENET_URING_BUFFER_GROUP;
+
+    if (syscall (__NR_io_uring_register, uring -> receive.fd, IORING_REGISTER_PBUF_RING, & bufferReg, 1) < 0)
+      goto failure;
+
+    for (bufferID = 0; bufferID < ENET_URING_BUFFER_COUNT; ++ bufferID)
+      enet_uring_recycle (uring, bufferID);
+    enet_uring_publish (uring);
+
+    /* Receive completions wake enet_host_wait through the waiter's eventfd */
+    if (syscall (__NR_io_uring_register, uring -> receive.fd, IORING_REGISTER_EVENTFD, & waiter -> wakeup [0], 1) < 0 ||
+        enet_uring_arm (uring) < 0)
+      goto failure;
+
+    return uring;
+
+failure:
+    enet_uring_destroy (uring);
+
+    return NULL;
+}
+
+void
+enet_uring_destroy (ENetUring * uring)
+{
+    if (uring == NULL)
+      return;
+
+    enet_uring_queue_destroy (& uring -> receive);
+    enet_uring_queue_destroy (& uring -> send);
+
+    if (uring -> bufferRing != NULL)
+      munmap (uring -> bufferRing, uring -> bufferRingSize);
+
+    if (uring -> buffers != NULL)
+      enet_free (uring -> buffers);
+
+    enet_free (uring);
+}
+
+int
+enet_uring_pending (ENetUring * uring)
+{
+    return * uring -> receive.cqHead != __atomic_load_n (uring -> receive.cqTail, __ATOMIC_ACQUIRE);
+}
+
+int
+enet_uring_receive_batch (ENetUring * uring, ENetSocketBatch * batch)
+{
+    ENetUringQueue * queue = & uring -> receive;
+    unsigned head = * queue -> cqHead,
+             tail = __atomic_load_n (queue -> cqTail, __ATOMIC_ACQUIRE);
+    int result = 0;
+
+    batch -> count = 0;
+    batch -> next = 0;
+    batch -> offset = 0;
+
+    for (; head != tail && batch -> count < batch -> capacity; ++ head)
+    {
+        struct io_uring_cqe * cqe = & queue -> cqes [head & queue -> cqMask];
+        struct io_uring_recvmsg_out * header;
+        struct sockaddr_in * sin;
+        enet_uint8 * buffer;
+        enet_uint16 bufferID;
+
+        if (! (cqe -> flags & IORING_CQE_F_MORE))
+          uring -> receiveArmed = 0;
+
+        if (! (cqe -> flags & IORING_CQE_F_BUFFER))
+        {
+            /* Running out of buffers only ends the multishot, it is armed again below */
+            if (cqe -> res < 0 && cqe -> res != -ENOBUFS)
+              result = -1;
+
+            continue;
+        }
+
+        bufferID = (enet_uint16) (cqe -> flags >> IORING_CQE_BUFFER_SHIFT);
+        buffer = & uring -> buffers [bufferID * ENET_URING_BUFFER_SIZE];
+        header = (struct io_uring_recvmsg_out *) buffer;
+        sin = (struct sockaddr_in *) (buffer + sizeof (struct io_uring_recvmsg_out));
+
+        if (cqe -> res >= 0 && ! (header -> flags & MSG_TRUNC) &&
+            header -> namelen >= sizeof (struct sockaddr_in) &&
+            header -> payloadlen <= batch -> slotSize)
+        {
+            memcpy (& batch -> data [batch -> count * batch -> slotSize],
+                    buffer + sizeof (struct io_uring_recvmsg_out) + uring -> receiveHeader.msg_namelen,
+                    header -> payloadlen);
+
+            batch -> addresses [batch -> count].host = (enet_uint32) sin -> sin_addr.s_addr;
+            batch -> addresses [batch -> count].port = ENET_NET_TO_HOST_16 (sin -> sin_port);
+            batch -> lengths [batch -> count] = header -> payloadlen;
+            batch -> segmentSizes [batch -> count] = 0;
+            batch -> count ++;
+        }
+
+        enet_uring_recycle (uring, bufferID);
+    }
+
+    __atomic_store_n (queue -> cqHead, head, __ATOMIC_RELEASE);
+    enet_uring_publish (uring);
+
+    if (! uring -> receiveArmed && enet_uring_arm (uring) < 0)
+      return -1;
+
+    if (result < 0 && batch -> count == 0)
+      return -1;
+
+    return (int) batch -> count;
+}
+
+int
+enet_uring_send_batch (ENetUring * uring, ENetSocketBatch * batch)
+{
+    ENetUringQueue * queue = & uring -> send;
+    unsigned head, tail, submitCount = 0;
+    size_t messageIndex;
+    int sentLength = 0, result = 0;
+
+    for (messageIndex = 0; messageIndex < batch -> count; ++ messageIndex)
+    {
+        struct sockaddr_in * sin = & uring -> sendAddresses [messageIndex];
+        struct msghdr * msgHdr = & uring -> sendHeaders [messageIndex];
+        struct io_uring_sqe * sqe = enet_uring_queue_get (queue);
+
+        if (sqe == NULL)
+          break;
+
+        memset (sin, 0, sizeof (struct sockaddr_in));
+        sin -> sin_family = AF_INET;
+        sin -> sin_port = ENET_HOST_TO_NET_16 (batch -> addresses [messageIndex].port);
+        sin -> sin_addr.s_addr = batch -> addresses [messageIndex].host;
+
+        uring -> sendBuffers [messageIndex].iov_base = & batch -> data [messageIndex * batch -> slotSize];
+        uring -> sendBuffers [messageIndex].iov_len = batch -> lengths [messageIndex];
+
+        memset (msgHdr, 0, sizeof (struct msghdr));
+        msgHdr -> msg_name = sin;
+        msgHdr -> msg_namelen = sizeof (struct sockaddr_in);
+        msgHdr -> msg_iov = & uring -> sendBuffers [messageIndex];
+        msgHdr -> msg_iovlen = 1;
+
+        sqe -> opcode = IORING_OP_SENDMSG;
+        sqe -> fd = uring -> socket;
+        sqe -> addr = (__u64) (size_t) msgHdr;
+        sqe -> len = 1;
+        sqe -> msg_flags = MSG_NOSIGNAL;
+
+        ++ submitCount;
+    }
+
+    batch -> count = 0;
+
+    if (submitCount == 0)
+      return 0;
+
+    /* The batch slots are reused by the next send pass, so every send is waited for */
+    if (enet_uring_queue_enter (queue, submitCount, submitCount) < 0)
+      return -1;
+
+    head = * queue -> cqHead;
+    tail = __atomic_load_n (queue -> cqTail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++ head)
+    {
+        struct io_uring_cqe * cqe = & queue -> cqes [head & queue -> cqMask];
+
+        /* Like enet_socket_send, datagrams which would block are dropped */
+        if (cqe -> res >= 0)
+          sentLength += cqe -> res;
+        else
+        if (cqe -> res != -EAGAIN && cqe -> res != -EWOULDBLOCK)
+          result = -1;
+    }
+
+    __atomic_store_n (queue -> cqHead, head, __ATOMIC_RELEASE);
+
+    return result < 0 ? -1 : sentLength;
+}
+
+#else
+
+ENetUring *
+enet_uring_create (ENetSocket socket, ENetHostWaiter * waiter)
+{
+    return NULL;
+}
+
+void
+enet_uring_destroy (ENetUring * uring)
+{
+}
+
+int
+enet_uring_pending (ENetUring * uring)
+{
+    return 0;
+}
+
+int
+enet_uring_receive_batch (ENetUring * uring, ENetSocketBatch * batch)
+{
+    return -1;
+}
+
+int
+enet_uring_send_batch (ENetUring * uring, ENetSocketBatch * batch)
+{
+    return -1;
+}
+
+#endif
@@ -0,0 +1,207 @@
+/** 
+ @file wheel.c
+ @brief ENet hierarchical timing wheel functions
+*/
+#define ENET_BUILDING_LIB 1
+#include "enet/enet.h"
+#include "enet/time.h"
+
+/** 
+    @defgroup wheel ENet timing wheel functions
+    @ingroup private
+    @{
+*/
+void
+enet_timer_wheel_init (ENetTimerWheel * wheel, enet_uint32 time)
+{
+    size_t slot, level;
+
+    wheel -> time = time;
+    wheel -> pendingCount = 0;
+
+    for (slot = 0; slot < ENET_TIMER_WHEEL_NEAR_SLOTS; ++ slot)
+      enet_list_clear (& wheel -> near [slot]);
+
+    for (level = 0; level < ENET_TIMER_WHEEL_FAR_LEVELS; ++ level)
+      for (slot = 0; slot < ENET_TIMER_WHEEL_FAR_SLOTS; ++ slot)
+        enet_list_clear (& wheel -> far [level] [slot]);
+
+    enet_list_clear (& wheel -> expired);
+}
+
+static void
+enet_timer_wheel_insert (ENetTimerWheel * wheel, ENetTimer * timer)
+{
+    enet_uint32 delta = timer -> deadline - wheel -> time;
+    ENetList * slot;
+    size_t level, shift;
+
+    if (delta < ENET_TIMER_WHEEL_NEAR_SLOTS)
+      slot = & wheel -> near [timer -> deadline & (ENET_TIMER_WHEEL_NEAR_SLOTS - 1)];
+    else
+    {
+        for (level = 0, shift = ENET_TIMER_WHEEL_NEAR_BITS + ENET_TIMER_WHEEL_FAR_BITS;
+             level + 1 < ENET_TIMER_WHEEL_FAR_LEVELS && delta >= ((enet_uint32) 1 << shift);
+             ++ level, shift += ENET_TIMER_WHEEL_FAR_BITS)
+          ;
+
+        /* Beyond the last level the timer fires early and its owner schedules it again */
+        if (delta >= ((enet_uint32) 1 << shift))
+          timer -> deadline = wheel -> time + ((enet_uint32) 1 << shift) - 1;
+
+        shift -= ENET_TIMER_WHEEL_FAR_BITS;
+        slot = & wheel -> far [level] [(timer -> deadline >> shift) & (ENET_TIMER_WHEEL_FAR_SLOTS - 1)];
+    }
+
+    enet_list_insert (enet_list_end (slot), & timer -> timerList);
+}
+
+/** Schedules the timer at the deadline, replacing an earlier schedule.
+    A deadline which already passed puts the timer in the expired list at once.
+*/
+void
+enet_timer_wheel_schedule (ENetTimerWheel * wheel, ENetTimer * timer, enet_uint32 deadline)
+{
+    enet_timer_wheel_cancel (wheel, timer);
+
+    timer -> deadline = deadline;
+
+    if (ENET_TIME_LESS (deadline, wheel -> time))
+    {
+        enet_list_insert (enet_list_end (& wheel -> expired), & timer -> timerList);
+
+        timer -> state = ENET_TIMER_STATE_EXPIRED;
+
+        return;
+    }
+
+    enet_timer_wheel_insert (wheel, timer);
+
+    timer -> state = ENET_TIMER_STATE_PENDING;
+    ++ wheel -> pendingCount;
+}
+
+void
+enet_timer_wheel_cancel (ENetTimerWheel * wheel, ENetTimer * timer)
+{
+    if (timer -> state == ENET_TIMER_STATE_IDLE)
+      return;
+
+    if (timer -> state == ENET_TIMER_STATE_PENDING)
+      -- wheel -> pendingCount;
+
+    enet_list_remove (& timer -> timerList);
+
+    timer -> state = ENET_TIMER_STATE_IDLE;
+}
+
+static size_t
+enet_timer_wheel_cascade (ENetTimerWheel * wheel, size_t level)
+{
+    size_t slot = (wheel -> time >> (ENET_TIMER_WHEEL_NEAR_BITS + level * ENET_TIMER_WHEEL_FAR_BITS)) & (ENET_TIMER_WHEEL_FAR_SLOTS - 1);
+    ENetList * timers = & wheel -> far [level] [slot];
+
+    while (! enet_list_empty (timers))
+      enet_timer_wheel_insert (wheel, (ENetTimer *) enet_list_remove (enet_list_begin (timers)));
+
+    return slot;
+}
+
+/** Moves every timer due at or before the given time to the expired list. */
+void
+enet_timer_wheel_advance (ENetTimerWheel * wheel, enet_uint32 time)
+{
+    while (ENET_TIME_LESS_EQUAL (wheel -> time, time))
+    {
+        size_t slot = wheel -> time & (ENET_TIMER_WHEEL_NEAR_SLOTS - 1), level;
+        ENetList * timers = & wheel -> near [slot];
+
+        if (wheel -> pendingCount == 0)
+        {
+            wheel -> time = time + 1;
+
+            break;
+        }
+
+        /* Crossing a boundary of a coarser level brings its next slot down */
+        if (slot == 0)
+        {
+            for (level = 0; level < ENET_TIMER_WHEEL_FAR_LEVELS; ++ level)
+              if (enet_timer_wheel_cascade (wheel, level) != 0)
+                break;
+        }
+
+        while (! enet_list_empty (timers))
+        {
+            ENetTimer * timer = (ENetTimer *) enet_list_remove (enet_list_begin (timers));
+
+            enet_list_insert (enet_list_end (& wheel -> expired), & timer -> timerList);
+
+            timer -> state = ENET_TIMER_STATE_EXPIRED;
+            -- wheel -> pendingCount;
+        }
+
+        ++ wheel -> time;
+    }
+}
+
+/** Finds the earliest time at which a timer may expire.
+
+    @returns 0 if no timer is scheduled, otherwise 1 with the time stored in nextTime.
+    For timers in coarser levels this is the start of their slot, so the wheel
+    may be advanced before they are due.
+*/
+int
+enet_timer_wheel_next (ENetTimerWheel * wheel, enet_uint32 * nextTime)
+{
+    size_t slot, level, shift;
+    int found = 0;
+
+    if (! enet_list_empty (& wheel -> expired))
+    {
+        * nextTime = wheel -> time - 1;
+
+        return 1;
+    }
+
+    if (wheel -> pendingCount == 0)
+      return 0;
+
+    for (slot = 0; slot < ENET_TIMER_WHEEL_NEAR_SLOTS; ++ slot)
+    {
+        if (! enet_list_empty (& wheel -> near [(wheel -> time + slot) & (ENET_TIMER_WHEEL_NEAR_SLOTS - 1)]))
+        {
+            * nextTime = wheel -> time + slot;
+            found = 1;
+
+            break;
+        }
+    }
+
+    for (level = 0, shift = ENET_TIMER_WHEEL_NEAR_BITS;
+         level < ENET_TIMER_WHEEL_FAR_LEVELS;
+         ++ level, shift += ENET_TIMER_WHEEL_FAR_BITS)
+    {
+        /* The current slot of a level is cascaded when the wheel reaches its start,
+           after that it holds the next round */
+        size_t first = (wheel -> time & (((enet_uint32) 1 << shift) - 1)) == 0 ? 0 : 1;
+
+        for (slot = first; slot < first + ENET_TIMER_WHEEL_FAR_SLOTS; ++ slot)
+        {
+            enet_uint32 slotTime = ((wheel -> time >> shift) + slot) << shift;
+
+            if (enet_list_empty (& wheel -> far [level] [((wheel -> time >> shift) + slot) & (ENET_TIMER_WHEEL_FAR_SLOTS - 1)]))
+              continue;
+
+            if (! found || ENET_TIME_LESS (slotTime, * nextTime))
+              * nextTime = slotTime;
+            found = 1;
+
+            break;
+        }
+    }
+
+    return found;
+}
+
+/** @} */
@@ -192,6 +192,11 @@ enet_socket_set_option (ENetSocket socket, ENetSocketOption option, int value)
             result = setsockopt (socket, SOL_SOCKET, SO_REUSEADDR, (char *) & value, sizeof (int));
             break;
 
+        case ENET_SOCKOPT_REUSEPORT:
+            /* Winsock has no load-balancing equivalent of SO_REUSEPORT, the
+             * option fails so hosts asking for it are not created */
+            break;
+
         case ENET_SOCKOPT_RCVBUF:
             result = setsockopt (socket, SOL_SOCKET, SO_RCVBUF, (char *) & value, sizeof (int));
             break;
@@ -370,6 +375,67 @@ enet_socket_receive (ENetSocket socket,
     return (int) recvLength;
 }
 
+/* Winsock has no multi-datagram calls, batches are moved one datagram at a time */
+int
+enet_socket_send_batch (ENetSocket socket, ENetSocketBatch * batch)
+{
+    size_t messageIndex;
+    int sentLength = 0;
+
+    for (messageIndex = 0; messageIndex < batch -> count; ++ messageIndex)
+    {
+        ENetBuffer buffer;
+        int length;
+
+        buffer.data = & batch -> data [messageIndex * batch -> slotSize];
+        buffer.dataLength = batch -> lengths [messageIndex];
+
+        length = enet_socket_send (socket, & batch -> addresses [messageIndex], & buffer, 1);
+        if (length < 0)
+        {
+            batch -> count = 0;
+
+            return -1;
+        }
+
+        sentLength += length;
+    }
+
+    batch -> count = 0;
+
+    return sentLength;
+}
+
+int
+enet_socket_receive_batch (ENetSocket socket, ENetSocketBatch * batch)
+{
+    batch -> count = 0;
+    batch -> next = 0;
+    batch -> offset = 0;
+
+    while (batch -> count < batch -> capacity)
+    {
+        ENetBuffer buffer;
+        int length;
+
+        buffer.data = & batch -> data [batch -> count * batch -> slotSize];
+        buffer.dataLength = batch -> slotSize;
+
+        length = enet_socket_receive (socket, & batch -> addresses [batch -> count], & buffer, 1);
+        if (length < 0)
+          return -1;
+
+        if (length == 0)
+          break;
+
+        batch -> lengths [batch -> count] = (size_t) length;
+        batch -> segmentSizes [batch -> count] = 0;
+        batch -> count ++;
+    }
+
+    return (int) batch -> count;
+}
+
 int
 enet_socketset_select (ENetSocket maxSocket, ENetSocketSet * readSet, ENetSocketSet * writeSet, enet_uint32 timeout)
 {
@@ -419,5 +485,340 @@ enet_socket_wait (ENetSocket socket, enet_uint32 * condition, enet_uint32 timeou
     return 0;
 } 
 
+int
+enet_host_waiter_create (ENetHostWaiter * waiter, ENetSocket socket)
+{
+    waiter -> socketEvent = WSACreateEvent ();
+    if (waiter -> socketEvent == WSA_INVALID_EVENT)
+      return -1;
+
+    waiter -> wakeup = WSACreateEvent ();
+    if (waiter -> wakeup == WSA_INVALID_EVENT)
+    {
+        WSACloseEvent (waiter -> socketEvent);
+
+        return -1;
+    }
+
+    if (WSAEventSelect (socket, waiter -> socketEvent, FD_READ) == SOCKET_ERROR)
+    {
+        enet_host_waiter_destroy (waiter);
+
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+enet_host_waiter_destroy (ENetHostWaiter * waiter)
+{
+    WSACloseEvent (waiter -> socketEvent);
+    WSACloseEvent (waiter -> wakeup);
+}
+
+int
+enet_host_waiter_wait (ENetHostWaiter * waiter, ENetSocket socket, enet_uint32 timeout)
+{
+    WSAEVENT events [2] = { waiter -> socketEvent, waiter -> wakeup };
+    WSANETWORKEVENTS networkEvents;
+    DWORD result;
+
+    result = WSAWaitForMultipleEvents (2, events, FALSE, timeout, FALSE);
+    if (result == WSA_WAIT_TIMEOUT)
+      return 0;
+
+    if (result == WSA_WAIT_FAILED)
+      return -1;
+
+    /* FD_READ is signalled again by the next receive while data is pending */
+    WSAEnumNetworkEvents (socket, waiter -> socketEvent, & networkEvents);
+    WSAResetEvent (waiter -> wakeup);
+
+    return 1;
+}
+
+void
+enet_host_waiter_wake (ENetHostWaiter * waiter)
+{
+    WSASetEvent (waiter -> wakeup);
+}
+
+typedef struct _ENetWaitEntry
+{
+    ENetListNode node;
+    ENetHost *   host;      /**< NULL for an application socket */
+    ENetSocket   socket;
+    void *       data;
+    int          ready;
+    WSAEVENT     socketEvent;   /**< signalled by WSAEventSelect for an application socket */
+} ENetWaitEntry;
+
+struct _ENetWaitSet
+{
+    ENetList     entries;
+    size_t       eventCount;
+    WSAEVENT     events [WSA_MAXIMUM_WAIT_EVENTS];
+};
+
+/** Creates an empty wait set.
+
+    A thread which services many hosts sleeps on all of them at once with
+    enet_waitset_wait(). On Windows a set waits on the events of at most
+    WSA_MAXIMUM_WAIT_EVENTS / 2 hosts.
+*/
+ENetWaitSet *
+enet_waitset_create (void)
+{
+    ENetWaitSet * set = (ENetWaitSet *) enet_malloc (sizeof (ENetWaitSet));
+    if (set == NULL)
+      return NULL;
+    memset (set, 0, sizeof (ENetWaitSet));
+
+    enet_list_clear (& set -> entries);
+
+    return set;
+}
+
+static void
+enet_waitset_free_entry (ENetWaitEntry * entry)
+{
+    if (entry -> host == NULL)
+    {
+        WSAEventSelect (entry -> socket, NULL, 0);
+        WSACloseEvent (entry -> socketEvent);
+    }
+
+    enet_free (entry);
+}
+
+void
+enet_waitset_destroy (ENetWaitSet * set)
+{
+    if (set == NULL)
+      return;
+
+    while (! enet_list_empty (& set -> entries))
+      enet_waitset_free_entry ((ENetWaitEntry *) enet_list_remove (enet_list_begin (& set -> entries)));
+
+    enet_free (set);
+}
+
+static int
+enet_waitset_add (ENetWaitSet * set, ENetHost * host, ENetSocket socket, void * data)
+{
+    ENetWaitEntry * entry;
+
+    if (set -> eventCount + (host != NULL ? 2 : 1) > WSA_MAXIMUM_WAIT_EVENTS)
+      return -1;
+
+    entry = (ENetWaitEntry *) enet_malloc (sizeof (ENetWaitEntry));
+    if (entry == NULL)
+      return -1;
+
+    entry -> host = host;
+    entry -> socket = socket;
+    entry -> data = data;
+    entry -> ready = 0;
+    entry -> socketEvent = WSA_INVALID_EVENT;
+
+    if (host != NULL)
+      set -> eventCount += 2;
+    else
+    {
+        /* WSAEventSelect makes the socket non-blocking and replaces earlier selections */
+        entry -> socketEvent = WSACreateEvent ();
+        if (entry -> socketEvent == WSA_INVALID_EVENT)
+        {
+            enet_free (entry);
+
+            return -1;
+        }
+
+        if (WSAEventSelect (socket, entry -> socketEvent, FD_READ | FD_ACCEPT | FD_CLOSE) == SOCKET_ERROR)
+        {
+            WSACloseEvent (entry -> socketEvent);
+            enet_free (entry);
+
+            return -1;
+        }
+
+        set -> eventCount += 1;
+    }
+
+    enet_list_insert (enet_list_end (& set -> entries), entry);
+
+    return 0;
+}
+
+static void
+enet_waitset_remove_entry (ENetWaitSet * set, ENetHost * host, ENetSocket socket)
+{
+    ENetListIterator currentEntry;
+
+    for (currentEntry = enet_list_begin (& set -> entries);
+         currentEntry != enet_list_end (& set -> entries);
+         currentEntry = enet_list_next (currentEntry))
+    {
+       ENetWaitEntry * entry = (ENetWaitEntry *) currentEntry;
+
+       if (entry -> host != host || (host == NULL && entry -> socket != socket))
+         continue;
+
+       set -> eventCount -= (host != NULL ? 2 : 1);
+
+       enet_list_remove (currentEntry);
+       enet_waitset_free_entry (entry);
+
+       return;
+    }
+}
+
+/** Adds a host to the wait set, it is reported when it has to be serviced. */
+int
+enet_waitset_add_host (ENetWaitSet * set, ENetHost * host, void * data)
+{
+    return enet_waitset_add (set, host, host -> socket, data);
+}
+
+void
+enet_waitset_remove_host (ENetWaitSet * set, ENetHost * host)
+{
+    enet_waitset_remove_entry (set, host, host -> socket);
+}
+
+/** Adds an application socket, it is reported while it is readable. */
+int
+enet_waitset_add_socket (ENetWaitSet * set, ENetSocket socket, void * data)
+{
+    return enet_waitset_add (set, NULL, socket, data);
+}
+
+void
+enet_waitset_remove_socket (ENetWaitSet * set, ENetSocket socket)
+{
+    enet_waitset_remove_entry (set, NULL, socket);
+}
+
+static enet_uint32
+enet_waitset_get_timeout (ENetWaitSet * set, enet_uint32 timeout)
+{
+    ENetListIterator currentEntry;
+
+    for (currentEntry = enet_list_begin (& set -> entries);
+         currentEntry != enet_list_end (& set -> entries) && timeout > 0;
+         currentEntry = enet_list_next (currentEntry))
+    {
+       ENetWaitEntry * entry = (ENetWaitEntry *) currentEntry;
+
+       if (entry -> host != NULL)
+         timeout = enet_host_get_timeout (entry -> host, timeout);
+    }
+
+    return timeout;
+}
+
+static int
+enet_waitset_is_signalled (WSAEVENT event)
+{
+    return WSAWaitForMultipleEvents (1, & event, FALSE, 0, FALSE) == WSA_WAIT_EVENT_0;
+}
+
+/** Sleeps until a host of the set has to be serviced, an application socket is readable or the timeout expires.
+
+    @param set        wait set to sleep on
+    @param events     receives the hosts and sockets which are ready
+    @param eventCount size of the events array, the rest is reported by the next call
+    @param timeout    number of milliseconds to wait at most
+    @retval > 0 number of reported events
+    @retval 0 if the timeout expired
+    @retval < 0 on failure
+    @remarks enet_host_wake() on a host of the set interrupts the wait and reports the host
+*/
+int
+enet_waitset_wait (ENetWaitSet * set, ENetWaitEvent * events, size_t eventCount, enet_uint32 timeout)
+{
+    ENetListIterator currentEntry;
+    size_t waitCount = 0, eventIndex = 0;
+    DWORD result;
+
+    for (currentEntry = enet_list_begin (& set -> entries);
+         currentEntry != enet_list_end (& set -> entries);
+         currentEntry = enet_list_next (currentEntry))
+    {
+       ENetWaitEntry * entry = (ENetWaitEntry *) currentEntry;
+
+       if (entry -> host != NULL)
+       {
+           set -> events [waitCount ++] = entry -> host -> waiter.socketEvent;
+           set -> events [waitCount ++] = entry -> host -> waiter.wakeup;
+       }
+       else
+         set -> events [waitCount ++] = entry -> socketEvent;
+    }
+
+    timeout = enet_waitset_get_timeout (set, timeout);
+
+    if (waitCount == 0)
+    {
+        Sleep (timeout);
+
+        return 0;
+    }
+
+    result = WSAWaitForMultipleEvents ((DWORD) waitCount, set -> events, FALSE, timeout, FALSE);
+    if (result == WSA_WAIT_FAILED)
+      return -1;
+
+    /* Only the first signalled event is returned, the others are checked one by one */
+    for (currentEntry = enet_list_begin (& set -> entries);
+         currentEntry != enet_list_end (& set -> entries);
+         currentEntry = enet_list_next (currentEntry))
+    {
+       ENetWaitEntry * entry = (ENetWaitEntry *) currentEntry;
+       WSANETWORKEVENTS networkEvents;
+       int ready = entry -> ready;
+
+       if (entry -> host != NULL)
+       {
+           if (! ready)
+             ready = enet_waitset_is_signalled (entry -> host -> waiter.socketEvent) ||
+                     enet_waitset_is_signalled (entry -> host -> waiter.wakeup) ||
+                     enet_host_get_timeout (entry -> host, 1) == 0;
+
+           if (! ready || eventIndex >= eventCount)
+           {
+               entry -> ready = ready;
+
+               continue;
+           }
+
+           enet_host_waiter_wait (& entry -> host -> waiter, entry -> socket, 0);
+       }
+       else
+       {
+           if (! ready && enet_waitset_is_signalled (entry -> socketEvent))
+             ready = WSAEnumNetworkEvents (entry -> socket, entry -> socketEvent, & networkEvents) == 0 &&
+                     networkEvents.lNetworkEvents != 0;
+
+           if (! ready || eventIndex >= eventCount)
+           {
+               entry -> ready = ready;
+
+               continue;
+           }
+       }
+
+       entry -> ready = 0;
+
+       events [eventIndex].host = entry -> host;
+       events [eventIndex].socket = entry -> socket;
+       events [eventIndex].data = entry -> data;
+       ++ eventIndex;
+    }
+
+    return (int) eventIndex;
+}
+
 #endif
 
@@ -42,6 +42,13 @@ typedef fd_set ENetSocketSet;
 #define ENET_SOCKETSET_ADD(sockset, socket)    FD_SET (socket, & (sockset))
 #define ENET_SOCKETSET_REMOVE(sockset, socket) FD_CLR (socket, & (sockset))
 #define ENET_SOCKETSET_CHECK(sockset, socket)  FD_ISSET (socket, & (sockset))
+
+/** Blocking wait on a host socket which other threads can interrupt */
+typedef struct
+{
+    int poll;         /**< epoll instance on Linux, -1 where poll() is used */
+    int wakeup [2];   /**< read and write ends of the wakeup, the same eventfd on Linux */
+} ENetHostWaiter;
     
 #endif /* __ENET_UNIX_H__ */
 
@@ -0,0 +1,54 @@
+/** 
+ @file  wheel.h
+ @brief ENet hierarchical timing wheel
+*/
+#ifndef __ENET_WHEEL_H__
+#define __ENET_WHEEL_H__
+
+#include "enet/types.h"
+#include "enet/list.h"
+
+enum
+{
+   ENET_TIMER_WHEEL_NEAR_BITS  = 8,
+   ENET_TIMER_WHEEL_NEAR_SLOTS = 1 << ENET_TIMER_WHEEL_NEAR_BITS,   /**< one slot per millisecond */
+   ENET_TIMER_WHEEL_FAR_BITS   = 6,
+   ENET_TIMER_WHEEL_FAR_SLOTS  = 1 << ENET_TIMER_WHEEL_FAR_BITS,
+   ENET_TIMER_WHEEL_FAR_LEVELS = 3                                   /**< timers up to 2^26 ms ahead, later ones fire early */
+};
+
+typedef enum _ENetTimerState
+{
+   ENET_TIMER_STATE_IDLE    = 0,
+   ENET_TIMER_STATE_PENDING = 1,   /**< waits in a slot of the wheel */
+   ENET_TIMER_STATE_EXPIRED = 2    /**< waits in the expired list until its owner handles it */
+} ENetTimerState;
+
+typedef struct _ENetTimer
+{
+   ENetListNode timerList;
+   enet_uint32  deadline;
+   enet_uint8   state;
+} ENetTimer;
+
+/** Timers of a host, insertion and expiry cost O(1) regardless of their number.
+    Near timers sit in per-millisecond slots, far ones in coarser levels which
+    cascade down as the wheel turns.
+ */
+typedef struct _ENetTimerWheel
+{
+   enet_uint32 time;                                                        /**< next millisecond to expire */
+   size_t      pendingCount;
+   ENetList    near [ENET_TIMER_WHEEL_NEAR_SLOTS];
+   ENetList    far [ENET_TIMER_WHEEL_FAR_LEVELS] [ENET_TIMER_WHEEL_FAR_SLOTS];
+   ENetList    expired;                                                     /**< timers whose deadline passed, in expiry order */
+} ENetTimerWheel;
+
+extern void enet_timer_wheel_init (ENetTimerWheel *, enet_uint32);
+extern void enet_timer_wheel_schedule (ENetTimerWheel *, ENetTimer *, enet_uint32);
+extern void enet_timer_wheel_cancel (ENetTimerWheel *, ENetTimer *);
+extern void enet_timer_wheel_advance (ENetTimerWheel *, enet_uint32);
+extern int  enet_timer_wheel_next (ENetTimerWheel *, enet_uint32 *);
+
+#endif /* __ENET_WHEEL_H__ */
+
@@ -52,6 +52,13 @@ typedef fd_set ENetSocketSet;
 #define ENET_SOCKETSET_REMOVE(sockset, socket) FD_CLR (socket, & (sockset))
 #define ENET_SOCKETSET_CHECK(sockset, socket)  FD_ISSET (socket, & (sockset))
 
+/** Blocking wait on a host socket which other threads can interrupt */
+typedef struct
+{
+    WSAEVENT socketEvent;   /**< signalled by WSAEventSelect when the socket is readable */
+    WSAEVENT wakeup;        /**< signalled by enet_host_wake */
+} ENetHostWaiter;
+
 #endif /* __ENET_WIN32_H__ */
 
 
@@ -48,4 +48,51 @@ namespace Native {
         return CloseHandle(mutex.handle);
     }
 
+    // ------------------------------------------------------------------------
+    // Thread implementation
+    // ------------------------------------------------------------------------
+    struct ThreadStart {
+        ThreadProc proc;
+        void* arg;
+    };
+
+    // ------------------------------------------------------------------------
+    static DWORD WINAPI thread_start(LPVOID param)
+    {
+        ThreadStart start = *(ThreadStart*)param;
+        delete (ThreadStart*)param;
+
+        start.proc(start.arg);
+        return 0;
+    }
+
+    // ------------------------------------------------------------------------
+    M_EXPORT Thread thread_invalid()
+    {
+        return Thread{ INVALID_HANDLE_VALUE };
+    }
+
+    // ------------------------------------------------------------------------
+    M_EXPORT Thread thread_create(ThreadProc proc, void* arg)
+    {
+        ThreadStart* start = new ThreadStart{ proc, arg };
+
+        Thread thread;
+        thread.handle = CreateThread(nullptr, 0, thread_start, start, 0, nullptr);
+        if (thread.handle == nullptr) {
+            delete start;
+            return thread_invalid();
+        }
+        return thread;
+    }
+
+    // ------------------------------------------------------------------------
+    M_EXPORT int thread_join(Thread thread)
+    {
+        if (thread.handle == INVALID_HANDLE_VALUE) return 0;
+
+        WaitForSingleObject(thread.handle, INFINITE);
+        return CloseHandle(thread.handle);
+    }
+
 } // namespace Native
\ No newline at end of file
@@ -19,6 +19,15 @@ namespace Native {
 
     M_EXPORT int mutex_destroy(Mutex mutex);
 
+
+    struct Thread { void* handle; };
+    using ThreadProc = void(*)(void* arg);
+
+    M_EXPORT Thread thread_invalid();
+    M_EXPORT Thread thread_create(ThreadProc proc, void* arg);
+
+    M_EXPORT int thread_join(Thread thread);
+
 } // namespace Native
 
 
@@ -0,0 +1,108 @@
+#include "net_test/net_transport.h"
+#include "net_test/net_replication.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#pragma comment (lib, "Ws2_32.lib")
+#pragma comment (lib, "winmm.lib")
+
+
+// Field list with a container member
+struct CheckRecord {
+    uint32_t id;
+    Array<uint16_t> items;
+    float weight;
+};
+M_NET_FIELDS(CheckRecord, M_NET_FIELD(CheckRecord, id), M_NET_FIELD(CheckRecord, items), M_NET_FIELD(CheckRecord, weight));
+
+
+void check_serializers()
+{
+    uint16_t items[] = { 1, 2, 0xffff };
+    CheckRecord record{ 7, Data::toArray(items, 3), 0.5f };
+
+    Memory::RegBuffer data;
+    NetSerializer<CheckRecord>::pack(data, record);
+
+    Memory::ChainAllocator alloc;
+    CBytes input{ data.memory.begin, data.memory.begin + data.size() };
+    CheckRecord copy = NetSerializer<CheckRecord>::unpack(alloc, input);
+
+    M_ASSERT_MSG(!isRejected(input) && Data::count(input) == 0, "Field list is not read back whole");
+    M_ASSERT_MSG(copy.id == record.id && copy.weight == record.weight, "Plain fields do not round-trip");
+    M_ASSERT_MSG(Data::count(copy.items) == 3, "Array field does not round-trip");
+    for (size_t i = 0; i < 3; ++i) {
+        M_ASSERT_MSG(copy.items[i] == items[i], "Array field does not round-trip");
+    }
+}
+
+
+void check_delta_codec()
+{
+    uint8_t baseline[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    uint8_t state[8] = { 0, 1, 9, 3, 4, 5, 6, 8 };
+    uint8_t decoded[8];
+
+    Memory::RegBuffer data;
+    NetDeltaCodec::encode(data, Data::toBytes(&baseline), Data::toBytes(&state));
+
+    CBytes delta{ data.memory.begin, data.memory.begin + data.size() };
+    bool ok = NetDeltaCodec::decode(Data::toBytes(&baseline), delta, Data::toBytes(&decoded));
+    M_ASSERT_MSG(ok && memcmp(decoded, state, sizeof(state)) == 0, "Delta does not round-trip");
+
+    // Zero run which wraps the position around to the start of the state
+    data.reset();
+    writeVarint(data, UINT64_MAX);
+    writeVarint(data, 2);
+    Bytes literals = data.reserve(2);
+    literals[0] = literals[1] = 0xff;
+
+    delta = CBytes{ data.memory.begin, data.memory.begin + data.size() };
+    ok = NetDeltaCodec::decode(Data::toBytes(&baseline), delta, Data::toBytes(&decoded));
+    M_ASSERT_MSG(!ok, "Forged delta skip is accepted");
+
+    // Literal run ending one byte past the state
+    data.reset();
+    writeVarint(data, 7);
+    writeVarint(data, 2);
+    literals = data.reserve(2);
+    literals[0] = literals[1] = 0xff;
+
+    delta = CBytes{ data.memory.begin, data.memory.begin + data.size() };
+    ok = NetDeltaCodec::decode(Data::toBytes(&baseline), delta, Data::toBytes(&decoded));
+    M_ASSERT_MSG(!ok, "Forged delta literals are accepted");
+}
+
+
+void check_fingerprint()
+{
+    // FIPS 180-2 example, the digest of "abc"
+    static Data::Byte const expected[32] = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+    };
+
+    NetSha256 sha;
+    sha.update(Data::toBytes("abc", 3));
+
+    Data::Byte digest[32];
+    sha.finish(digest);
+    M_ASSERT_MSG(memcmp(digest, expected, sizeof(expected)) == 0, "SHA-256 digest is wrong");
+
+    NetHandlerHash rows[] = { { 1, 0 }, { 2, 1 } };
+    NetHandlerHash swapped[] = { { 1, 1 }, { 2, 0 } };
+    M_ASSERT_MSG(NetEventNames::fingerprint(Data::toArray(rows, 2)) != NetEventNames::fingerprint(Data::toArray(swapped, 2)),
+        "Fingerprint ignores handler ids");
+}
+
+
+int main()
+{
+    check_serializers();
+    check_delta_codec();
+    check_fingerprint();
+
+    printf("> checks passed\n");
+    return 0;
+}
\ No newline at end of file
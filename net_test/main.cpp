@@ -13,7 +13,7 @@ void init_client(NetHost& host)
     auto handshake = new NetProtocolHandshake;
     auto game = new NetProtocolGameClient;
 
-    handshake->bind(host);
+    handshake->bind(host, NetHandshakeMode::Hashed);
     game->bind_reliable(host);
     game->bind_unreliable(host);
 
@@ -24,6 +24,11 @@ void init_client(NetHost& host)
 }
 
 
+#ifdef SERVER
+static NetProtocolGameServer* server_game = nullptr;
+#endif
+
+
 void init_server(NetHost& host)
 {
 #ifdef SERVER
@@ -31,12 +36,14 @@ void init_server(NetHost& host)
 
     auto handshake = new NetProtocolHandshake;
     auto game = new NetProtocolGameServer;
+    server_game = game;
 
-    handshake->bind(host);
+    handshake->bind(host, NetHandshakeMode::Hashed);
     game->level = "test_scene";
     game->bind_reliable(host);
     game->bind_unreliable(host);
     handshake->onConnected += std::bind(&NetProtocolGameServer::onConnected, game, _1);
+    host.onDisconnected = std::bind(&NetProtocolGameServer::onDisconnected, game, _1);
 
     bool ok = host.listen(32, NetAddress::ipv4("127.0.0.1", 1200));
     M_ASSERT_MSG(ok, "Cannot launch host");
@@ -52,13 +59,33 @@ int main()
     {
         NetHost client("Client");
         NetHost server("Server");
+        client.setWireFormat(NetWireFormat::Compact);
+        server.setWireFormat(NetWireFormat::Compact);
+        client.setCompression(NetCompression::LzShared);
+        server.setCompression(NetCompression::LzShared);
+        server.setBatchedIo(true);
+        server.setIoUring(true);
+        client.addChannel(NetChannelType::ReliableOrdered);
+        client.addChannel(NetChannelType::UnreliableSequenced);
+        server.addChannel(NetChannelType::ReliableOrdered);
+        server.addChannel(NetChannelType::UnreliableSequenced);
 
         init_client(client);
         init_server(server);
+
+        // Both hosts share the thread, the client sleeps until the next game
+        // tick or its own traffic, whatever it sends is serviced right after
+        uint32_t tick = enet_time_get();
         while (true) {
-            client.update();
-            server.update();
-            Sleep(100);
+            uint32_t now = enet_time_get();
+            if ((int32_t)(now - tick) >= 0) {
+#ifdef SERVER
+                server_game->update();
+#endif
+                tick = now + 100;
+            }
+            server.poll(0);
+            client.poll(tick - now);
         }
     }
     enet_deinitialize();
@@ -1 +1,11 @@
-#include "net_event.h"
\ No newline at end of file
+#include "net_event.h"
+
+
+// ----------------------------------------------------------------------------
+// NetBroadcastResolver implementation
+// ----------------------------------------------------------------------------
+NetBroadcastResolver& NetBroadcastResolver::name(char const* str)
+{
+    m_hash = NetEventNames::hashName(m_hash, str);
+    return *this;
+}
\ No newline at end of file
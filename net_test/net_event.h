@@ -11,15 +11,15 @@ using Data::Bytes;
 template <class... ArgsTy>
 class NetEvent {
 public:
-    NetEvent() : m_peers(nullptr), m_handler(0), m_entry(0) {}
-    NetEvent(Memory::RaPool<NetPeer> const& peers, size_t entry, size_t handler)
-        : m_peers(&peers), m_handler(handler), m_entry(entry) {}
+    NetEvent() : m_schema(nullptr), m_handler(0), m_entry(0) {}
+    NetEvent(NetHostSchema const& schema, size_t entry, size_t handler)
+        : m_schema(&schema), m_handler(handler), m_entry(entry) {}
 
     template <class... TailTy>
     void operator()(NetPeerId const& peer, TailTy&&... args);
 
 private:
-    Memory::RaPool<NetPeer> const* m_peers;
+    NetHostSchema const* m_schema;
     size_t m_handler;
     size_t m_entry;
 };
@@ -31,21 +31,62 @@ class NetEvent<void>
 public:
     NetEvent() : NetEvent<>() {}
     NetEvent(NetEvent<> const& e) : NetEvent<>(e) {}
-    NetEvent(Memory::RaPool<NetPeer> const& peers, size_t entry, size_t handler)
-        : NetEvent<>(peers, entry, handler) {}
+    NetEvent(NetHostSchema const& schema, size_t entry, size_t handler)
+        : NetEvent<>(schema, entry, handler) {}
+};
+
+
+// Event sent to a set of peers. The arguments are serialized once and copied
+// to every peer, the handler id is routed by the path hash in each peer's names.
+// Only the peers of one shard are reached, other shards get their own broadcasts.
+template <class... ArgsTy>
+class NetBroadcast {
+public:
+    NetBroadcast() : m_schema(nullptr), m_entry(0), m_hash(0), m_shard(0) {}
+    NetBroadcast(NetHostSchema const& schema, size_t entry, uint64_t hash, size_t shard)
+        : m_schema(&schema), m_entry(entry), m_hash(hash), m_shard(shard) {}
+
+    template <class... TailTy>
+    void operator()(Data::CArray<NetPeerId> peers, TailTy&&... args);
+
+private:
+    NetHostSchema const* m_schema;
+    size_t m_entry;
+    uint64_t m_hash;
+    size_t m_shard;
+
+    Memory::RegBuffer m_payload;
+};
+
+
+class NetBroadcastResolver {
+public:
+    NetBroadcastResolver(NetHostSchema const& schema, size_t entry, size_t shard)
+        : m_schema(schema), m_entry(entry), m_hash(NetEventNames::RootHash), m_shard(shard) {}
+
+    NetBroadcastResolver& name(char const* str);
+
+    template <class... ArgsTy>
+    operator NetBroadcast<ArgsTy...>() const;
+
+private:
+    NetHostSchema const& m_schema;
+    size_t m_entry;
+    uint64_t m_hash;
+    size_t m_shard;
 };
 
 
 class NetEventProxy {
 public:
-    NetEventProxy(Memory::RaPool<NetPeer> const& peers, size_t entry, size_t handler)
-        : m_entry(entry), m_handler(handler), m_peers(peers) {}
+    NetEventProxy(NetHostSchema const& schema, size_t entry, size_t handler)
+        : m_entry(entry), m_handler(handler), m_schema(schema) {}
 
     template <class... ArgsTy>
-    operator NetEvent<ArgsTy...>() { return NetEvent<ArgsTy...>(m_peers, m_entry, m_handler); }
+    operator NetEvent<ArgsTy...>() { return NetEvent<ArgsTy...>(m_schema, m_entry, m_handler); }
 
 private:
-    Memory::RaPool<NetPeer> const& m_peers;
+    NetHostSchema const& m_schema;
     size_t m_handler;
     size_t m_entry;
 };
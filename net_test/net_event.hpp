@@ -7,11 +7,55 @@ void NetEvent<ArgsTy...>::operator()(NetPeerId const& peerId, TailTy&&... args)
 {
     using expand_type = int[];
 
-    auto& peer = (*m_peers)[peerId.index];
+    // Ids of disconnected peers are stale, their slot may be released or reused
+    auto& peer = m_schema->peer(peerId);
+    if (peer.nonce != peerId.nonce) return;
+
     auto& output = peer.output.data[m_entry];
+    m_schema->packHandler(output, m_handler);
+
+    NetBitWriter bits(output);
+    expand_type{ 0, (NetArgument<ArgsTy>::pack(bits, output, args), 0)... };
+    bits.flush();
+
+    peer.output.commit(m_entry);
+}
+
+// ----------------------------------------------------------------------------
+template <class... ArgsTy>
+template <class... TailTy>
+void NetBroadcast<ArgsTy...>::operator()(Data::CArray<NetPeerId> peers, TailTy&&... args)
+{
+    using expand_type = int[];
 
-    uint32_t hid = static_cast<uint32_t>(m_handler);
-    Data::write(&output.reserve(sizeof(uint32_t)), hid);
+    m_payload.reset();
 
-    expand_type{ 0, (NetSerializer<ArgsTy>::pack(output, args), 0)... };
+    NetBitWriter bits(m_payload);
+    expand_type{ 0, (NetArgument<ArgsTy>::pack(bits, m_payload, args), 0)... };
+    bits.flush();
+
+    CBytes payload{ m_payload.memory.begin, m_payload.memory.begin + m_payload.size() };
+    for (NetPeerId const& peerId : Data::iterate(peers)) {
+        // Peers of other shards are reached by their own broadcasts
+        if (peerId.shard != m_shard) continue;
+
+        auto& peer = m_schema->peer(peerId);
+        if (peer.nonce != peerId.nonce) continue;
+
+        // Peers without the handler are skipped instead of asserting
+        size_t hid = peer.names->routes.lookup(m_hash);
+        if (hid == SIZE_MAX) continue;
+
+        auto& output = peer.output.data[m_entry];
+        m_schema->packHandler(output, hid);
+        Data::write(&output.reserve(Data::count(payload)), payload);
+        peer.output.commit(m_entry);
+    }
+}
+
+// ----------------------------------------------------------------------------
+template <class... ArgsTy>
+NetBroadcastResolver::operator NetBroadcast<ArgsTy...>() const
+{
+    return NetBroadcast<ArgsTy...>(m_schema, m_entry, m_hash, m_shard);
 }
\ No newline at end of file
@@ -6,47 +6,29 @@
 // ----------------------------------------------------------------------------
 // NetNameResolver implementation
 // ----------------------------------------------------------------------------
-NetNameResolver::NetNameResolver(NetEventNames const& names)
-    : m_names(names), m_entry{ Entry::Scope, 0 }
+NetNameResolver::NetNameResolver(NetRoutingTable const& routes)
+    : m_routes(routes), m_hash(NetEventNames::RootHash)
 {
 }
 
 // ----------------------------------------------------------------------------
 NetNameResolver& NetNameResolver::name(char const* str)
 {
-    M_ASSERT(m_entry.type == Entry::Scope);
-
-    Group const& group = m_names.groups[m_entry.index];
-    Entry const* entry = group.entries.lookup(str);
-
-    if (entry == nullptr) {
-        m_entry.type = Entry::Handler;
-        m_entry.index = -1;
-    }
-    else {
-        m_entry.type = entry->type;
-        m_entry.index = entry->index;
-    }
+    m_hash = NetEventNames::hashName(m_hash, str);
     return *this;
 }
 
 // ----------------------------------------------------------------------------
 NetNameResolver& NetNameResolver::index(size_t idx)
 {
-    M_ASSERT(m_entry.type == Entry::List);
-
-    Group const& group = m_names.groups[m_entry.index];
-    Entry const& entry = group.entries.rows[idx].value;
-
-    m_entry = entry;
+    m_hash = NetEventNames::hashIndex(m_hash, idx);
     return *this;
 }
 
 // ----------------------------------------------------------------------------
 size_t NetNameResolver::get() const
 {
-    M_ASSERT(m_entry.type == Entry::Handler);
-    return m_entry.index;
+    return m_routes.lookup(m_hash);
 }
 
 // ----------------------------------------------------------------------------
@@ -7,19 +7,18 @@
 class NetHandlerIface;
 
 
+// Hashes a path of names and indices, routed by the table of the remote schema
 class NetNameResolver {
-    using Entry = NetEventNames::Entry;
-    using Group = NetEventNames::Group;
 public:
-    NetNameResolver(NetEventNames const& names);
+    NetNameResolver(NetRoutingTable const& routes);
 
     NetNameResolver& name(char const* str);
     NetNameResolver& index(size_t idx);
     size_t get() const;
 
 private:
-    NetEventNames const& m_names;
-    Entry m_entry;
+    NetRoutingTable const& m_routes;
+    uint64_t m_hash;
 };
 
 
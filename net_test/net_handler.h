@@ -2,7 +2,11 @@
 
 #include "core/data/array.h"
 #include "core/memory/buddy_heap.h"
+#include "net_serializer.h"
+#include "net_transport.h"
 #include <functional>
+#include <utility>
+#include <tuple>
 
 
 using Data::Array;
@@ -11,10 +15,31 @@ using Data::Bytes;
 class NetConnection;
 
 
+// Unpacks the arguments of a message in wire order and calls the function,
+// unless the input is too short for them or turns out malformed
+template <class... ArgsTy>
+struct NetArguments {
+    static constexpr size_t MinSize = NetMinSizeSum<ArgsTy...>::value;
+
+    template <class FuncTy>
+    static bool apply(FuncTy const& func, NetConnection& conn, Memory::IAllocator& alloc, CBytes& input);
+
+private:
+    template <class FuncTy, size_t... Indices>
+    static void invoke(FuncTy const& func, NetConnection& conn, std::tuple<ArgsTy...>& args, std::index_sequence<Indices...>);
+};
+
+
 class NetHandlerIface {
 public:
     virtual ~NetHandlerIface() = default;
-    virtual void call(NetConnection& conn, CBytes& input) = 0;
+    virtual bool call(NetConnection& conn, Memory::IAllocator& frame, CBytes& input) = 0;
+
+    // Dispatches through the virtual call, for handlers which are not methods
+    NetHandlerRecord record() { return NetHandlerRecord{ &NetHandlerIface::thunk, this }; }
+
+private:
+    static bool thunk(void* target, NetConnection& conn, Memory::IAllocator& frame, CBytes& input);
 };
 
 
@@ -25,18 +50,36 @@ class NetHandler
 public:
     using Function = std::function<void(NetConnection& sender, ArgsTy...)>;
 public:
+    // Arguments are unpacked into the host's per-update frame arena unless
+    // an allocator which outlives the handler call is given
     NetHandler(Function const& func) : NetHandler(nullptr, func) {}
     NetHandler(Memory::IAllocator* alloc, Function const& func) 
-        : m_alloc(alloc ? *alloc : Memory::buddy_global_heap), m_func(func) {}
+        : m_alloc(alloc), m_func(func) {}
 
-    virtual void call(NetConnection& conn, CBytes& input) override;
+    virtual bool call(NetConnection& conn, Memory::IAllocator& frame, CBytes& input) override;
 
 private:
-    Memory::IAllocator& m_alloc;
+    Memory::IAllocator* m_alloc;
     Function m_func;
 };
 
 
+// Method known at compile time. Its thunk unpacks the arguments and calls the
+// method directly, a message then costs the one jump through the thunk pointer.
+template <class MethodTy, MethodTy Method>
+struct NetMethod;
+
+template <class ClsTy, class... ArgsTy, void(ClsTy::*Method)(NetConnection&, ArgsTy...)>
+struct NetMethod<void(ClsTy::*)(NetConnection&, ArgsTy...), Method> {
+    static NetHandlerRecord record(ClsTy* pThis) { return NetHandlerRecord{ &NetMethod::thunk, pThis }; }
+
+private:
+    static bool thunk(void* target, NetConnection& conn, Memory::IAllocator& frame, CBytes& input);
+};
+
+#define M_NET_METHOD(CLS, NAME) NetMethod<decltype(&CLS::NAME), &CLS::NAME>()
+
+
 struct NetHandlerInfo {
     char const* name;
     NetHandlerIface* handler;
@@ -47,7 +90,56 @@ struct NetHandlerInfo {
 
 // ----------------------------------------------------------------------------
 template <class... ArgsTy>
-void NetHandler<ArgsTy...>::call(NetConnection& conn, CBytes& input)
+template <class FuncTy>
+bool NetArguments<ArgsTy...>::apply(FuncTy const& func, NetConnection& conn, Memory::IAllocator& alloc, CBytes& input)
+{
+    // One check against the fewest bytes of all arguments, the reads of the
+    // variable sized ones reject the input when it ends early or is invalid
+    if (Data::count(input) < MinSize) {
+        rejectInput(input);
+        return false;
+    }
+
+    // Braced initialization keeps the arguments unpacked in wire order
+    NetBitReader bits(input);
+    std::tuple<ArgsTy...> args{ NetArgument<ArgsTy>::unpack(bits, alloc, input)... };
+    bits.flush();
+
+    if (isRejected(input)) {
+        return false;
+    }
+    invoke(func, conn, args, std::index_sequence_for<ArgsTy...>());
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+template <class... ArgsTy>
+template <class FuncTy, size_t... Indices>
+void NetArguments<ArgsTy...>::invoke(FuncTy const& func, NetConnection& conn, std::tuple<ArgsTy...>& args, std::index_sequence<Indices...>)
+{
+    func(conn, std::move(std::get<Indices>(args))...);
+}
+
+// ----------------------------------------------------------------------------
+inline bool NetHandlerIface::thunk(void* target, NetConnection& conn, Memory::IAllocator& frame, CBytes& input)
+{
+    return static_cast<NetHandlerIface*>(target)->call(conn, frame, input);
+}
+
+// ----------------------------------------------------------------------------
+template <class... ArgsTy>
+bool NetHandler<ArgsTy...>::call(NetConnection& conn, Memory::IAllocator& frame, CBytes& input)
+{
+    Memory::IAllocator& alloc = m_alloc ? *m_alloc : frame;
+    return NetArguments<ArgsTy...>::apply(m_func, conn, alloc, input);
+}
+
+// ----------------------------------------------------------------------------
+template <class ClsTy, class... ArgsTy, void(ClsTy::*Method)(NetConnection&, ArgsTy...)>
+bool NetMethod<void(ClsTy::*)(NetConnection&, ArgsTy...), Method>::thunk(void* target, NetConnection& conn, Memory::IAllocator& frame, CBytes& input)
 {
-    m_func(conn, NetSerializer<ArgsTy>::unpack(m_alloc, input)...);
+    ClsTy* pThis = static_cast<ClsTy*>(target);
+    return NetArguments<ArgsTy...>::apply([pThis](NetConnection& conn, ArgsTy&&... args) {
+        (pThis->*Method)(conn, std::forward<ArgsTy>(args)...);
+    }, conn, frame, input);
 }
\ No newline at end of file
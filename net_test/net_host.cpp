@@ -1,5 +1,7 @@
 #include "net_host.h"
 
+#include "core/memory/string.h"
+
 
 using namespace Data;
 
@@ -8,7 +10,7 @@ using namespace Data;
 // NetEventResolver implementation
 // ----------------------------------------------------------------------------
 NetEventResolver::NetEventResolver(NetHostState& state, NetPeerId peer, size_t channel)
-    : m_state(state), m_channel(channel), m_resolver(state.peers[peer.index].names)
+    : m_state(state), m_channel(channel), m_resolver(state.schema.peer(peer).names->routes)
 {
 }
 
@@ -30,7 +32,7 @@ NetEventResolver& NetEventResolver::index(size_t idx)
 // ----------------------------------------------------------------------------
 NetEventProxy NetEventResolver::get() const
 {
-    return NetEventProxy(m_state.peers, m_channel, m_resolver.get());
+    return NetEventProxy(m_state.schema, m_channel, m_resolver.get());
 }
 
 // ----------------------------------------------------------------------------
@@ -44,7 +46,7 @@ NetConnection::NetConnection(NetHostState& state, NetPeerId source)
 // ----------------------------------------------------------------------------
 NetPeerId NetConnection::peer(size_t index) const
 {
-    return NetPeerId(index, m_state.peers[index].nonce);
+    return NetPeerId(index, m_state.peers[index].nonce, m_state.shard);
 }
 
 // ----------------------------------------------------------------------------
@@ -62,14 +64,43 @@ size_t NetConnection::peers() const
 // ----------------------------------------------------------------------------
 NetEventNamesRef NetConnection::getNames(NetPeerId peer) const
 {
-    return m_state.peers[peer.index].names;
+    return m_state.schema.peer(peer).names->names;
+}
+
+// ----------------------------------------------------------------------------
+bool NetConnection::setNames(NetPeerId peer, NetEventNamesRef names) const
+{
+    NetPeer& target = m_state.schema.peer(peer);
+
+    // Interned before the old names are released, a repeated handshake keeps them
+    NetSharedNames* shared = m_state.internNames(names);
+    if (shared == nullptr) {
+        enet_peer_disconnect(target.enetPeer, 0);
+        return false;
+    }
+    m_state.releaseNames(target.names);
+    target.names = shared;
+
+    if (m_state.schema.compression == NetCompression::LzShared) {
+        m_state.attachDictionary(target);
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+bool NetConnection::setHashes(NetPeerId peer, Data::Array<NetHandlerHash> hashes) const
+{
+    // Without groups the peer's names are resolved by hashes
+    return setNames(peer, NetEventNamesRef(Data::Array<NetEventNames::Group>(), hashes));
 }
 
 // ----------------------------------------------------------------------------
-void NetConnection::setNames(NetPeerId peer, NetEventNamesRef names) const
+void NetConnection::setSynchronized(NetPeerId peer) const
 {
-    m_state.peers[peer.index].names.groups.clear();
-    m_state.peers[peer.index].names.groups.insert(names.groups);
+    NetPeer& target = m_state.schema.peer(peer);
+    if (target.dictionary != nullptr) {
+        enet_peer_compress(target.enetPeer, &target.dictionary->sending);
+    }
 }
 
 // ----------------------------------------------------------------------------
@@ -78,146 +109,687 @@ NetEventResolver NetConnection::event(size_t channel) const
     return NetEventResolver(m_state, m_source, channel);
 }
 
+// ----------------------------------------------------------------------------
+NetBroadcastResolver NetConnection::broadcast(size_t channel) const
+{
+    return NetBroadcastResolver(m_state.schema, channel, m_state.shard);
+}
+
+// ----------------------------------------------------------------------------
+// NetHostAllocator implementation
+// ----------------------------------------------------------------------------
+ENetAllocator NetHostAllocator::callbacks()
+{
+    ENetAllocator callbacks;
+    callbacks.context = this;
+    callbacks.allocate = &NetHostAllocator::alloc;
+    callbacks.deallocate = &NetHostAllocator::dealloc;
+    callbacks.destroy = nullptr;
+    return callbacks;
+}
+
+// ----------------------------------------------------------------------------
+void* NetHostAllocator::alloc(size_t size)
+{
+    if (size > MaxCellSize) {
+        return Memory::buddy_global_heap.alloc(size).begin;
+    }
+
+    size_t index = sizeClass(size);
+    return m_pools[index].alloc(cellSize(index));
+}
+
+// ----------------------------------------------------------------------------
+void NetHostAllocator::dealloc(void* ptr, size_t size)
+{
+    if (size > MaxCellSize) {
+        Memory::buddy_global_heap.dealloc(ptr);
+        return;
+    }
+    m_pools[sizeClass(size)].dealloc(ptr);
+}
+
+// ----------------------------------------------------------------------------
+size_t NetHostAllocator::sizeClass(size_t size)
+{
+    if (size <= SmallStep * SmallClasses) {
+        return (size == 0) ? 0 : (size - 1) / SmallStep;
+    }
+
+    size_t index = SmallClasses;
+    while (cellSize(index) < size) {
+        index += 1;
+    }
+    return index;
+}
+
+// ----------------------------------------------------------------------------
+size_t NetHostAllocator::cellSize(size_t sizeClass)
+{
+    if (sizeClass < SmallClasses) {
+        return (sizeClass + 1) * SmallStep;
+    }
+    return (SmallStep * SmallClasses) << (sizeClass - SmallClasses + 1);
+}
+
+// ----------------------------------------------------------------------------
+void* NetHostAllocator::alloc(void* context, size_t size)
+{
+    return static_cast<NetHostAllocator*>(context)->alloc(size);
+}
+
+// ----------------------------------------------------------------------------
+void NetHostAllocator::dealloc(void* context, void* ptr, size_t size)
+{
+    static_cast<NetHostAllocator*>(context)->dealloc(ptr, size);
+}
+
+// ----------------------------------------------------------------------------
+// NetHostState implementation
+// ----------------------------------------------------------------------------
+NetHostState::NetHostState(NetHostSchema& schema, size_t shard, size_t maxPeers)
+    : schema(schema), peers(maxPeers), enetHost(nullptr), shard(shard), nonce(0)
+{
+    unnamed.names.groups.append(NetEventNames::Group());
+}
+
+// ----------------------------------------------------------------------------
+NetHostState::~NetHostState()
+{
+    for (Memory::RegBuffer& buffer : iterate(spare.asArray())) {
+        buffer.~RegBuffer();
+    }
+    for (NetSharedDictionary* dictionary : iterate(dictionaries.asArray())) {
+        enet_lz_destroy(dictionary->receiving.context);
+        delete dictionary;
+    }
+    for (NetSharedNames* names : iterate(interned.asArray())) {
+        delete names;
+    }
+}
+
+// ----------------------------------------------------------------------------
+NetSharedNames* NetHostState::internNames(NetEventNamesRef names)
+{
+    using Group = NetEventNames::Group;
+
+    uint64_t hash = NetSharedNames::hashOf(names);
+    for (NetSharedNames* shared : iterate(interned.asArray())) {
+        if (shared->hash != hash || !NetSharedNames::isEqual(shared->names, names)) continue;
+
+        ++shared->refs;
+        return shared;
+    }
+
+    // Received names live in the frame arena, the copy keeps own keys
+    NetSharedNames* shared = new NetSharedNames();
+    for (Group const& group : iterate(names.groups)) {
+        Group* copy = new(shared->names.groups.alloc()) Group();
+        for (auto const& row : iterate(group.entries.rows)) {
+            copy->entries.insert(Memory::newString(shared->strings, row.key), row.value, row.hash);
+        }
+    }
+    for (NetHandlerHash const& row : iterate(names.hashes)) {
+        shared->names.hashes.append(row);
+    }
+
+    // Routes are compiled once, every peer of these names reuses them
+    bool routed;
+    if (shared->names.isHashed()) {
+        routed = shared->routes.build(shared->names.hashes.asArray());
+    }
+    else {
+        Memory::RaStack<NetHandlerHash> table;
+        shared->names.hashHandlers(table);
+        routed = shared->routes.build(table.asArray());
+    }
+    if (!routed) {
+        delete shared;
+        return nullptr;
+    }
+
+    shared->hash = hash;
+    shared->refs = 1;
+    interned.append(shared);
+    return shared;
+}
+
+// ----------------------------------------------------------------------------
+void NetHostState::releaseNames(NetSharedNames* names)
+{
+    if (names == &unnamed || --names->refs != 0) {
+        return;
+    }
+
+    Array<NetSharedNames*> all = interned.asArray();
+    for (size_t i = 0; i < count(all); ++i) {
+        if (all[i] != names) continue;
+
+        all[i] = all[count(all) - 1];
+        interned.pop();
+        break;
+    }
+    delete names;
+}
+
+// ----------------------------------------------------------------------------
+void NetHostState::attachDictionary(NetPeer& peer)
+{
+    detachDictionary(peer);
+
+    Memory::RegBuffer data;
+    schema.buildDictionary(data, peer.names->names);
+    CBytes bytes = toBytes(data.memory.begin, data.size());
+
+    for (NetSharedDictionary* dictionary : iterate(dictionaries.asArray())) {
+        if (dictionary->data.size() != count(bytes)) continue;
+        if (memcmp(dictionary->data.memory.begin, bytes.begin, count(bytes)) != 0) continue;
+
+        peer.dictionary = dictionary;
+        break;
+    }
+
+    if (peer.dictionary == nullptr) {
+        // Without a codec the peer keeps the host's one
+        void* codec = enet_lz_create(bytes.begin, count(bytes));
+        if (codec == nullptr) return;
+
+        NetSharedDictionary* dictionary = new NetSharedDictionary();
+        dictionary->data = std::move(data);
+        dictionary->refs = 0;
+
+        // Until synchronized, datagrams are received in both forms but sent uncompressed
+        dictionary->receiving.context = codec;
+        dictionary->receiving.compress = nullptr;
+        dictionary->receiving.decompress = &enet_lz_decompress;
+        dictionary->receiving.destroy = nullptr;
+
+        dictionary->sending = dictionary->receiving;
+        dictionary->sending.compress = &enet_lz_compress;
+
+        dictionaries.append(dictionary);
+        peer.dictionary = dictionary;
+    }
+
+    ++peer.dictionary->refs;
+    enet_peer_compress(peer.enetPeer, &peer.dictionary->receiving);
+}
+
+// ----------------------------------------------------------------------------
+void NetHostState::detachDictionary(NetPeer& peer)
+{
+    NetSharedDictionary* dictionary = peer.dictionary;
+    if (dictionary == nullptr) {
+        return;
+    }
+
+    enet_peer_compress(peer.enetPeer, nullptr);
+    peer.dictionary = nullptr;
+    if (--dictionary->refs != 0) {
+        return;
+    }
+
+    Array<NetSharedDictionary*> all = dictionaries.asArray();
+    for (size_t i = 0; i < count(all); ++i) {
+        if (all[i] != dictionary) continue;
+
+        all[i] = all[count(all) - 1];
+        dictionaries.pop();
+        break;
+    }
+    enet_lz_destroy(dictionary->receiving.context);
+    delete dictionary;
+}
+
 // ----------------------------------------------------------------------------
 // NetHost implementation
 // ----------------------------------------------------------------------------
-NetHost::NetHost(char const* dbgname)
-    : m_dbgname(dbgname)
+NetHost::NetHost(char const* dbgname, size_t shards)
+    : m_dbgname(dbgname), m_shardsCount(shards), m_hostFlags(0)
+    , m_waitSet(nullptr), m_running(0)
 {
+    M_ASSERT(shards != 0);
+#ifdef _WIN32
+    M_ASSERT_MSG(shards == 1, "Shards share the port through SO_REUSEPORT, which Winsock lacks");
+#endif
 }
 
 // ----------------------------------------------------------------------------
 NetHost::~NetHost()
 {
-    if (m_enetHost) {
-        for (auto const& peer : iterate(m_state.peers.asArray())) {
-            enet_peer_disconnect(peer.enetPeer, 0);
-            enet_peer_reset(peer.enetPeer);
+    stop();
+    close();
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::close()
+{
+    enet_waitset_destroy(m_waitSet);
+    m_waitSet = nullptr;
+
+    for (NetHostState& shard : iterate(m_shards)) {
+        if (shard.enetHost == nullptr) continue;
+
+        ENetHost* enetHost = shard.enetHost;
+        for (size_t i = 0; i < enetHost->peerCount; ++i) {
+            ENetPeer* enetPeer = &enetHost->peers[i];
+            if (enetPeer->data == nullptr) continue;
+
+            enet_peer_disconnect(enetPeer, 0);
+            enet_peer_reset(enetPeer);
         }
 
-        enet_host_destroy(m_enetHost);
+        enet_host_destroy(enetHost);
+    }
+    if (!isNull(m_shards)) {
+        Tools::destroyArray(m_shards);
+        m_shards = Array<NetHostState>();
     }
+    m_schema.shards.clear();
+}
+
+// ----------------------------------------------------------------------------
+NetHandlerBuilder NetHost::addHandler(NetHandlerRecord handler)
+{
+    size_t hid = m_schema.handlers.append(handler);
+    return NetHandlerBuilder(m_schema.names, hid);
 }
 
 // ----------------------------------------------------------------------------
-NetHandlerBuilder NetHost::addHandler(NetHandlerIface* handler)
+size_t NetHost::addChannel(NetChannelType type)
 {
-    size_t hid = m_state.handlers.append(handler);
-    return NetHandlerBuilder(m_state.names, hid);
+    M_ASSERT_MSG(isNull(m_shards), "Channels cannot change after the host is started");
+    M_ASSERT_MSG(m_schema.channels.count() < ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT, "Too many channels");
+
+    return m_schema.channels.append(type);
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::setWireFormat(NetWireFormat format)
+{
+    M_ASSERT_MSG(isNull(m_shards), "Wire format cannot change after the host is started");
+    m_schema.wire = format;
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::setBatchedIo(bool enabled, bool gro)
+{
+    M_ASSERT_MSG(isNull(m_shards), "Socket mode cannot change after the host is started");
+
+    m_hostFlags &= ~(ENET_HOST_FLAG_BATCH_IO | ENET_HOST_FLAG_UDP_GRO);
+    if (enabled) {
+        m_hostFlags |= gro ? ENET_HOST_FLAG_UDP_GRO : ENET_HOST_FLAG_BATCH_IO;
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::setIoUring(bool enabled)
+{
+    M_ASSERT_MSG(isNull(m_shards), "Socket mode cannot change after the host is started");
+    M_ASSERT_MSG(!enabled || (m_hostFlags & ENET_HOST_FLAG_UDP_GRO) == 0, "io_uring cannot be combined with UDP GRO");
+
+    m_hostFlags &= ~ENET_HOST_FLAG_IO_URING;
+    if (enabled) {
+        m_hostFlags |= ENET_HOST_FLAG_IO_URING;
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::setCompression(NetCompression compression)
+{
+    M_ASSERT_MSG(isNull(m_shards), "Compression cannot change after the host is started");
+    m_schema.compression = compression;
+}
+
+// ----------------------------------------------------------------------------
+NetBroadcastResolver NetHost::broadcast(size_t channel, size_t shard) const
+{
+    M_ASSERT(shard < m_shardsCount);
+    return NetBroadcastResolver(m_schema, channel, shard);
 }
 
 // ----------------------------------------------------------------------------
 bool NetHost::listen(size_t maxPeers, NetAddress::Storage address)
+{
+    M_ASSERT_MSG(isNull(m_shards), "Host is already listening");
+
+    // Shards created before a failure are destroyed, so listen may be retried
+    if (!open(maxPeers, address)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+bool NetHost::open(size_t maxPeers, NetAddress::Storage address)
 {
     ENetAddress enetAddr;
     enetAddr.host = (uint32_t)address.host;
     enetAddr.port = address.port;
 
-    m_enetHost = enet_host_create(&enetAddr, maxPeers, 1, 0, 0);
-    return (m_enetHost != nullptr);
+    // Every shard binds the same address, the kernel spreads peers between them.
+    // Without SO_REUSEPORT the hosts of the shards fail to be created.
+    size_t shardPeers = (maxPeers + m_shardsCount - 1) / m_shardsCount;
+    enet_uint32 flags = m_hostFlags;
+    if (m_shardsCount > 1) {
+        flags |= ENET_HOST_FLAG_REUSE_PORT;
+    }
+
+    // All shards are constructed first, close() destroys the whole array
+    m_shards = Tools::newArray<NetHostState>(nullptr, m_shardsCount);
+    for (size_t i = 0; i < m_shardsCount; ++i) {
+        NetHostState* shard = new(&m_shards[i]) NetHostState(m_schema, i, shardPeers);
+        m_schema.shards.append(&shard->peers);
+    }
+
+    for (NetHostState& shard : iterate(m_shards)) {
+        shard.enetHost = enet_host_create_ex(&enetAddr, shardPeers, m_schema.channelsCount(), 0, 0, flags);
+        if (shard.enetHost == nullptr && (flags & ENET_HOST_FLAG_IO_URING)) {
+            flags = (flags & ~ENET_HOST_FLAG_IO_URING) | ENET_HOST_FLAG_BATCH_IO;
+            shard.enetHost = enet_host_create_ex(&enetAddr, shardPeers, m_schema.channelsCount(), 0, 0, flags);
+        }
+        if (shard.enetHost == nullptr) return false;
+
+        ENetAllocator allocator = shard.allocator.callbacks();
+        enet_host_allocator(shard.enetHost, &allocator);
+
+        // Shared dictionaries are attached per peer, the host's codec compresses the handshake
+        if (m_schema.compression == NetCompression::RangeCoder) {
+            if (enet_host_compress_with_range_coder(shard.enetHost) < 0) return false;
+        }
+        else if (m_schema.compression != NetCompression::None) {
+            if (enet_host_compress_with_lz(shard.enetHost, nullptr, 0) < 0) return false;
+        }
+    }
+
+    // Polling on the calling thread sleeps on all shards at once
+    m_waitSet = enet_waitset_create();
+    if (m_waitSet == nullptr) return false;
+
+    for (NetHostState& shard : iterate(m_shards)) {
+        if (enet_waitset_add_host(m_waitSet, shard.enetHost, &shard) < 0) return false;
+    }
+    return true;
 }
 
 // ----------------------------------------------------------------------------
 bool NetHost::connect(NetAddress::Storage address)
 {
+    if (isNull(m_shards)) {
+        return false;
+    }
+
     ENetAddress enetAddr;
     enetAddr.host = (uint32_t)address.host;
     enetAddr.port = address.port;
 
-    ENetPeer* peer = enet_host_connect(m_enetHost, &enetAddr, 1, 0);
+    ENetPeer* peer = enet_host_connect(m_shards[0].enetHost, &enetAddr, m_schema.channelsCount(), 0);
     return (peer != nullptr);
 }
 
 // ----------------------------------------------------------------------------
 void NetHost::update()
 {
-    if (m_enetHost == nullptr) {
+    for (NetHostState& shard : iterate(m_shards)) {
+        update(shard, 0);
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::poll(uint32_t timeout)
+{
+    if (m_waitSet == nullptr) {
+        return;
+    }
+
+    ENetWaitEvent events[MaxShardEvents];
+    int ready = enet_waitset_wait(m_waitSet, events, MaxShardEvents, timeout);
+
+    for (int i = 0; i < ready; ++i) {
+        NetHostState& shard = *static_cast<NetHostState*>(events[i].data);
+        runPosted(shard);
+        update(shard, 0);
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::run()
+{
+    m_running = 1;
+    while (m_running) {
+        poll(MaxWait);
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::stop()
+{
+    m_running = 0;
+    for (NetHostState& shard : iterate(m_shards)) {
+        if (shard.enetHost == nullptr) continue;
+        enet_host_wake(shard.enetHost);
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::post(size_t shard, std::function<void()> task)
+{
+    NetHostState& target = m_shards[shard];
+    M_ASSERT_MSG(target.enetHost != nullptr, "Host is not listening");
+    {
+        Data::MutexGuard guard = target.postLock.guard();
+        target.posted.push_back(std::move(task));
+    }
+    enet_host_wake(target.enetHost);
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::runPosted(NetHostState& shard)
+{
+    {
+        Data::MutexGuard guard = shard.postLock.guard();
+        shard.running.swap(shard.posted);
+    }
+
+    // Tasks run unlocked, they may post again
+    for (std::function<void()>& task : shard.running) {
+        task();
+    }
+    shard.running.clear();
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::update(NetHostState& shard, uint32_t timeout)
+{
+    if (shard.enetHost == nullptr) {
         return;
     }
 
     ENetEvent event;
-    while (enet_host_service(m_enetHost, &event, 0)) {
+    while (enet_host_service(shard.enetHost, &event, timeout)) {
         switch (event.type) {
         case ENetEventType::ENET_EVENT_TYPE_DISCONNECT:
-            delPeer(event.peer);
+            delPeer(shard, event.peer);
             break;
         case ENetEventType::ENET_EVENT_TYPE_CONNECT:
-            addPeer(event.peer);
+            addPeer(shard, event.peer);
             break;
         case ENetEventType::ENET_EVENT_TYPE_RECEIVE:
-            receive(event.peer, event.packet);
+            // Handlers may hold NetView arguments into the packet until they return
+            receive(shard, event.peer, event.packet);
             enet_packet_destroy(event.packet);
             break;
         }
+        timeout = 0;
     }
 
-    send();
+    send(shard);
+    enet_host_flush(shard.enetHost);
+    shard.frame.reset();
 }
 
 // ----------------------------------------------------------------------------
-void NetHost::addPeer(ENetPeer* enetPeer)
+void NetHost::addPeer(NetHostState& shard, ENetPeer* enetPeer)
 {
-    NetPeer* peer = m_state.peers.alloc();
+    NetPeer* peer = shard.peers.alloc();
 
-    new(peer) NetPeer(NetPeerId::GenNonce(m_nonce), 1);
+    new(peer) NetPeer(NetPeerId::GenNonce(shard.nonce), m_schema.channelsCount());
+    peer->names = &shard.unnamed;
     peer->enetPeer = enetPeer;
     enetPeer->data = peer;
 
-    NetPeerId pid(m_state.peers.index(peer), peer->nonce);
-    onConnected(pid, m_state.names);
+    NetPeerId pid(shard.peers.index(peer), peer->nonce, shard.shard);
+    onConnected(pid, m_schema.names);
 }
 
 // ----------------------------------------------------------------------------
-void NetHost::delPeer(ENetPeer* enetPeer)
+void NetHost::delPeer(NetHostState& shard, ENetPeer* enetPeer)
 {
     NetPeer* peer = static_cast<NetPeer*>(enetPeer->data);
+    if (onDisconnected) {
+        onDisconnected(NetPeerId(shard.peers.index(peer), peer->nonce, shard.shard));
+    }
+
+    shard.detachDictionary(*peer);
+    shard.releaseNames(peer->names);
     peer->~NetPeer();
 
-    m_state.peers.dealloc(peer);
+    shard.peers.dealloc(peer);
     enetPeer->data = nullptr;
 }
 
 // ----------------------------------------------------------------------------
-void NetHost::receive(ENetPeer* enetPeer, ENetPacket* enetPacket)
+void NetHost::receive(NetHostState& shard, ENetPeer* enetPeer, ENetPacket* enetPacket)
 {
+    // Packets still queued from a rejected peer are dropped until it is gone
+    if (enetPeer->state == ENET_PEER_STATE_DISCONNECTING) {
+        return;
+    }
+
     NetPeer* peer = static_cast<NetPeer*>(enetPeer->data);
-    NetPeerId peerId(m_state.peers.index(peer), peer->nonce);
-    NetConnection conn(m_state, peerId);
+    NetPeerId peerId(shard.peers.index(peer), peer->nonce, shard.shard);
+    NetConnection conn(shard, peerId);
 
     // TODO: unpack input by transport protocols
     CBytes packet = toBytes(enetPacket->data, enetPacket->dataLength);
     while (true) {
-        uint32_t hid;
-        read(&packet, &hid);
-        if (hid == UINT32_MAX) return;
+        size_t hid = m_schema.unpackHandler(packet);
+        if (hid == SIZE_MAX && !isRejected(packet)) return;
+
+        // Malformed input disconnects the peer, the handlers of the packet
+        // which were called before keep their effects
+        if (hid >= m_schema.handlers.count()) break;
 
-        m_state.handlers[hid]->call(conn, packet);
+        NetHandlerRecord const& handler = m_schema.handlers[hid];
+        if (!handler.thunk(handler.target, conn, shard.frame, packet)) break;
     }
+    enet_peer_disconnect(enetPeer, 0);
 }
 
 // ----------------------------------------------------------------------------
-void NetHost::send()
+void NetHost::send(NetHostState& shard)
 {
-    Array<NetPeer> peers = m_state.peers.asArray();
-    for (NetPeer& peer : iterate(peers)) {
-        Array<Memory::RegBuffer> buffers = peer.output.data;
-        for (Memory::RegBuffer& data : iterate(buffers)) {
-            if (data.size() == 0) continue;
+    ENetHost* enetHost = shard.enetHost;
+    for (size_t i = 0; i < enetHost->peerCount; ++i) {
+        NetPeer* peer = static_cast<NetPeer*>(enetHost->peers[i].data);
+        if (peer == nullptr) continue;
 
-            Bytes bytes = peer.dataOut.reserve(data.size());
-            data.extract(bytes);
-            data.reset();
+        for (size_t channel = 0; channel < count(peer->output.data); ++channel) {
+            if (peer->output.data[channel].size() == 0) continue;
+
+            send(shard, peer, channel);
         }
-        if (peer.dataOut.size() == 0) {
-            continue;
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::send(NetHostState& shard, NetPeer* peer, size_t channel)
+{
+    Memory::RegBuffer& data = peer->output.data[channel];
+    Memory::RaStack<size_t>& ends = peer->output.ends[channel];
+    M_ASSERT_MSG(!ends.isEmpty() && ends.lastval() == data.size(), "Channel buffer ends with a partial message");
+
+    // The written buffer moves to the packets, the peer continues with a spare one
+    PacketHold* hold = (PacketHold*)Memory::buddy_global_heap.alloc(
+        sizeof(PacketHold) + sizeof(Memory::RegBuffer)).begin;
+    hold->shard = &shard;
+    hold->count = 1;
+    hold->refs = 1;
+
+    Memory::RegBuffer& buffer = *new(&hold->buffers()[0]) Memory::RegBuffer(std::move(data));
+    if (!shard.spare.isEmpty()) {
+        new(&data) Memory::RegBuffer(std::move(shard.spare.lastval()));
+        shard.spare.pop();
+    }
+
+    // Whole messages are packed up to the unfragmented packet size, a larger
+    // message goes alone so the fragments do not drag its neighbours along
+    size_t limit = enet_peer_get_fragment_length(peer->enetPeer) - count(m_schema.terminator());
+    size_t begin = 0;
+    size_t last = 0;
+    for (size_t end : iterate(ends.asArray())) {
+        if (end - begin > limit && last > begin) {
+            send(shard, peer, channel, hold, toBytes((void const*)(buffer.memory.begin + begin), last - begin));
+            begin = last;
         }
+        last = end;
+    }
+    send(shard, peer, channel, hold, toBytes((void const*)(buffer.memory.begin + begin), last - begin));
+    ends.reset();
+
+    if (--hold->refs == 0) {
+        release(hold);
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::send(NetHostState& shard, NetPeer* peer, size_t channel, PacketHold* hold, CBytes data)
+{
+    CBytes terminator = m_schema.terminator();
+
+    ENetBuffer segments[2];
+    segments[0].data = const_cast<Byte*>(data.begin);
+    segments[0].dataLength = count(data);
+    segments[1].data = const_cast<Byte*>(terminator.begin);
+    segments[1].dataLength = count(terminator);
+
+    // Unreliable messages too large for one packet must not turn into reliable fragments
+    enet_uint32 flags = m_schema.channelFlags(channel);
+    if ((flags & ENET_PACKET_FLAG_RELIABLE) == 0) {
+        flags |= ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+    }
+
+    ENetPacket* packet = enet_host_packet_create_gather(shard.enetHost, segments, 2, flags);
+    if (packet == nullptr) return;
 
-        write(&peer.dataOut.reserve(sizeof(uint32_t)), UINT32_MAX);
+    hold->refs += 1;
+    packet->userData = hold;
+    packet->freeCallback = &NetHost::release;
+    if (enet_peer_send(peer->enetPeer, (enet_uint8)channel, packet) < 0) {
+        enet_packet_destroy(packet);
+    }
+}
 
-        ENetPacket* packet = enet_packet_create(peer.dataOut.memory.begin, peer.dataOut.size(),
-            ENET_PACKET_FLAG_RELIABLE | ENET_PACKET_FLAG_NO_ALLOCATE);
-        enet_peer_send(peer.enetPeer, 0, packet);
+// ----------------------------------------------------------------------------
+void NetHost::release(ENetPacket* packet)
+{
+    PacketHold* hold = static_cast<PacketHold*>(packet->userData);
+    if (--hold->refs == 0) {
+        release(hold);
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetHost::release(PacketHold* hold)
+{
+    NetHostState& shard = *hold->shard;
+    for (size_t i = 0; i < hold->count; ++i) {
+        Memory::RegBuffer& buffer = hold->buffers()[i];
+        buffer.reset();
 
-        peer.dataOut.reset();
+        shard.spare.append(std::move(buffer));
+        buffer.~RegBuffer();
     }
+    Memory::buddy_global_heap.dealloc(hold);
 }
\ No newline at end of file
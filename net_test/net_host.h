@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core/memory/containers.h"
+#include "core/data/threading.h"
 #include "core/data/array.h"
 
 #include "net_event_names.h"
@@ -10,15 +11,95 @@
 
 #include "enet/enet.h"
 
+#include <functional>
+#include <vector>
+
 
 using Data::Bytes;
 using Data::Array;
 
 
+// Slab pools of one shard's ENet commands, acknowledgements and packets. Each
+// size class is a Memory::Pool with its own freelist, larger blocks such as
+// reassembled fragments go to the buddy heap.
+class NetHostAllocator {
+public:
+    ENetAllocator callbacks();
+
+    void* alloc(size_t size);
+    void dealloc(void* ptr, size_t size);
+
+private:
+    // 16 byte steps up to 256, then powers of two up to MaxCellSize
+    static constexpr size_t SmallStep = 16;
+    static constexpr size_t SmallClasses = 16;
+    static constexpr size_t LargeClasses = 4;
+    static constexpr size_t MaxCellSize = 4096;
+
+    Memory::Pool m_pools[SmallClasses + LargeClasses];
+
+    static size_t sizeClass(size_t size);
+    static size_t cellSize(size_t sizeClass);
+
+    static void* alloc(void* context, size_t size);
+    static void dealloc(void* context, void* ptr, size_t size);
+};
+
+
+// LZ codec primed with the preset dictionary of the connections which
+// exchanged the same names trees. A peer decodes with it as soon as it has the
+// remote names, but sends with it only after the remote confirmed it has ours.
+struct NetSharedDictionary {
+    Memory::RegBuffer data;
+    size_t refs;
+
+    ENetCompressor receiving;
+    ENetCompressor sending;
+};
+
+
+// One shard of a host: own ENet socket and peer pool
 struct NetHostState {
-    Memory::RaStack<NetHandlerIface*> handlers;
+    NetHostSchema& schema;
     Memory::RaPool<NetPeer> peers;
-    NetEventNames names;
+
+    // Channel buffers returned by sent packets, reused by the peers' output
+    Memory::RaStack<Memory::RegBuffer> spare;
+
+    // Handler arguments of one update() call, dropped after the service loop
+    Memory::ChainAllocator frame;
+
+    // Tasks posted from other threads, run by the thread polling the host.
+    // Vectors move them on growth, a RaStack would relocate them bitwise.
+    Data::Mutex postLock;
+    std::vector<std::function<void()>> posted;
+    std::vector<std::function<void()>> running;
+
+    // Serves the ENet host only, so it is touched by the servicing thread alone
+    NetHostAllocator allocator;
+
+    // Dictionaries of the connected peers, dropped with their last peer
+    Memory::RaStack<NetSharedDictionary*> dictionaries;
+
+    // Names of the connected peers by content, peers before the handshake
+    // share the unnamed ones
+    Memory::RaStack<NetSharedNames*> interned;
+    NetSharedNames unnamed;
+
+    ENetHost* enetHost;
+    size_t shard;
+    size_t nonce;
+
+public:
+    NetHostState(NetHostSchema& schema, size_t shard, size_t maxPeers);
+    ~NetHostState();
+
+    void attachDictionary(NetPeer& peer);
+    void detachDictionary(NetPeer& peer);
+
+    // Null when the routes of new names cannot be built
+    NetSharedNames* internNames(NetEventNamesRef names);
+    void releaseNames(NetSharedNames* names);
 };
 
 
@@ -43,13 +124,22 @@ public:
     NetConnection(NetHostState& state, NetPeerId source);
 
     NetEventNamesRef getNames(NetPeerId peer) const;
-    void setNames(NetPeerId peer, NetEventNamesRef names) const;
+
+    // False when the names cannot be routed, the peer is disconnected then
+    bool setNames(NetPeerId peer, NetEventNamesRef names) const;
+
+    // Hashes sorted by hash, they replace the names tree of the peer
+    bool setHashes(NetPeerId peer, Data::Array<NetHandlerHash> hashes) const;
+
+    // The remote holds our names too, shared dictionaries may be used for sending
+    void setSynchronized(NetPeerId peer) const;
 
     NetPeerId peer(size_t index) const;
     NetPeerId source() const;
     size_t peers() const;
 
     NetEventResolver event(size_t channel) const;
+    NetBroadcastResolver broadcast(size_t channel) const;
 
 private:
     NetHostState& m_state;
@@ -61,32 +151,100 @@ class NetHost {
 public:
     M_DECL_MOVE_ONLY(NetHost);
 
-    Memory::ChainAllocator allocator;
     std::function<void(NetPeerId, NetEventNames const&)> onConnected;
 
-    NetHost(char const* dbgname);
+    // Called before the peer slot is released, events sent to the id
+    // afterwards are dropped
+    std::function<void(NetPeerId)> onDisconnected;
+
+    // Several shards share one port through SO_REUSEPORT, so Windows hosts
+    // have one shard. All shards are serviced by the thread polling the host:
+    // they share the schema, the handlers and the global heap.
+    NetHost(char const* dbgname, size_t shards = 1);
     ~NetHost();
 
     template <class... ArgsTy>
-    NetEvent<ArgsTy...> addAnonymous(size_t channel, NetHandler<ArgsTy...>* handler);
-    NetHandlerBuilder addHandler(NetHandlerIface* handler);
+    NetEvent<ArgsTy...> addAnonymous(size_t channel, NetHandlerRecord handler);
+    NetHandlerBuilder addHandler(NetHandlerRecord handler);
+
+    // Channels are numbered in the order they are added, a host without
+    // added channels has one reliable ordered channel. Must match the remote.
+    size_t addChannel(NetChannelType type);
+
+    // Must match the wire format of the remote hosts
+    void setWireFormat(NetWireFormat format);
+
+    // Moves datagrams with recvmmsg/sendmmsg where available, optionally
+    // with kernel coalescing of received datagrams (UDP GRO)
+    void setBatchedIo(bool enabled, bool gro = false);
+
+    // Moves batched datagrams through io_uring, Linux only. Hosts fall back to
+    // recvmmsg/sendmmsg when the kernel refuses the ring. Excludes UDP GRO.
+    void setIoUring(bool enabled);
+
+    // Must match the compression of the remote hosts
+    void setCompression(NetCompression compression);
+
+    // Event which serializes its arguments once for the peers of one shard
+    NetBroadcastResolver broadcast(size_t channel, size_t shard = 0) const;
 
     bool listen(size_t maxPeers, NetAddress::Storage address);
     bool connect(NetAddress::Storage address);
 
+    // Services every shard on the calling thread
     void update();
 
+    // Sleeps until traffic arrives, an ENet timer is due, a task is posted or
+    // the timeout expires, then services the shards which are ready
+    void poll(uint32_t timeout);
+
+    // Polls on the calling thread until stop() is called, from any thread
+    void run();
+    void stop();
+
+    // Runs the task on the thread polling the host, waking it if it sleeps
+    void post(size_t shard, std::function<void()> task);
+
 private:
-    char const* m_dbgname;
+    // Owns the channel buffers of sent packets until ENet releases all of them
+    struct PacketHold {
+        NetHostState* shard;
+        size_t count;
+        size_t refs;
 
-    NetHostState m_state;
-    ENetHost* m_enetHost;
-    size_t m_nonce;
+        Memory::RegBuffer* buffers() { return reinterpret_cast<Memory::RegBuffer*>(this + 1); }
+    };
 
-    void addPeer(ENetPeer* peer);
-    void delPeer(ENetPeer* peer);
-    void receive(ENetPeer* peer, ENetPacket* packet);
-    void send();
+private:
+    char const* m_dbgname;
+
+    NetHostSchema m_schema;
+    Array<NetHostState> m_shards;
+    size_t m_shardsCount;
+    enet_uint32 m_hostFlags;
+    ENetWaitSet* m_waitSet;
+    Data::AtomicUint m_running;
+
+    // Longest sleep of a polling thread, stop() wakes it earlier
+    static constexpr uint32_t MaxWait = 1000;
+
+    // Shards serviced by one poll() call, the others wait for the next one
+    static constexpr size_t MaxShardEvents = 16;
+
+    bool open(size_t maxPeers, NetAddress::Storage address);
+    void close();
+
+    void update(NetHostState& shard, uint32_t timeout);
+    void runPosted(NetHostState& shard);
+
+    void addPeer(NetHostState& shard, ENetPeer* peer);
+    void delPeer(NetHostState& shard, ENetPeer* peer);
+    void receive(NetHostState& shard, ENetPeer* peer, ENetPacket* packet);
+    void send(NetHostState& shard);
+    void send(NetHostState& shard, NetPeer* peer, size_t channel);
+    void send(NetHostState& shard, NetPeer* peer, size_t channel, PacketHold* hold, CBytes data);
+    static void release(ENetPacket* packet);
+    static void release(PacketHold* hold);
 };
 
 
@@ -98,5 +256,14 @@ template <class ClsTy, class... ArgsTy>
 NetHandlerBuilder
     addHandler(NetHost& host, ClsTy* pThis, void(ClsTy::*handler)(NetConnection&, ArgsTy...));
 
+// Handlers bound by M_NET_METHOD, dispatched without the virtual call
+template <class ClsTy, class BaseTy, class... ArgsTy, void(BaseTy::*Method)(NetConnection&, ArgsTy...)>
+NetEvent<ArgsTy...>
+    addAnonymous(NetHost& host, size_t channel, ClsTy* pThis, NetMethod<void(BaseTy::*)(NetConnection&, ArgsTy...), Method>);
+
+template <class ClsTy, class MethodTy, MethodTy Method>
+NetHandlerBuilder
+    addHandler(NetHost& host, ClsTy* pThis, NetMethod<MethodTy, Method>);
+
 
 #include "net_host.hpp"
\ No newline at end of file
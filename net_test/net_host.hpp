@@ -10,7 +10,7 @@ NetEvent<ArgsTy...> addAnonymous(NetHost& host, size_t channel, ClsTy* pThis, vo
         (pThis->*handler)(conn, std::forward<ArgsTy>(args)...);
     }
     );
-    return host.addAnonymous<ArgsTy...>(channel, iface);
+    return host.addAnonymous<ArgsTy...>(channel, iface->record());
 }
 
 // ----------------------------------------------------------------------------
@@ -22,20 +22,35 @@ NetHandlerBuilder addHandler(NetHost& host, ClsTy* pThis, void(ClsTy::*handler)(
         (pThis->*handler)(conn, std::forward<ArgsTy>(args)...);
     }
     );
-    return host.addHandler(iface);
+    return host.addHandler(iface->record());
+}
+
+// ----------------------------------------------------------------------------
+template <class ClsTy, class BaseTy, class... ArgsTy, void(BaseTy::*Method)(NetConnection&, ArgsTy...)>
+NetEvent<ArgsTy...> addAnonymous(NetHost& host, size_t channel, ClsTy* pThis, NetMethod<void(BaseTy::*)(NetConnection&, ArgsTy...), Method>)
+{
+    using Bound = NetMethod<void(BaseTy::*)(NetConnection&, ArgsTy...), Method>;
+    return host.addAnonymous<ArgsTy...>(channel, Bound::record(pThis));
+}
+
+// ----------------------------------------------------------------------------
+template <class ClsTy, class MethodTy, MethodTy Method>
+NetHandlerBuilder addHandler(NetHost& host, ClsTy* pThis, NetMethod<MethodTy, Method>)
+{
+    return host.addHandler(NetMethod<MethodTy, Method>::record(pThis));
 }
 
 // ----------------------------------------------------------------------------
 template <class... ArgsTy>
-NetEvent<ArgsTy...> NetHost::addAnonymous(size_t channel, NetHandler<ArgsTy...>* handler)
+NetEvent<ArgsTy...> NetHost::addAnonymous(size_t channel, NetHandlerRecord handler)
 {
     auto isEmptyNamesTree = [](NetEventNames const& names) {
         if (names.groups.isEmpty()) return true;
         if (names.groups.count() > 1) return false;
         return Data::isEmpty(names.groups[0].entries);
     };
-    M_ASSERT_MSG(isEmptyNamesTree(m_state.names), "Anonymous handlers cannot be added after named handler");
+    M_ASSERT_MSG(isEmptyNamesTree(m_schema.names), "Anonymous handlers cannot be added after named handler");
 
-    size_t hid = m_state.handlers.append(handler);
-    return NetEvent<ArgsTy...>(m_state.peers, channel, hid);
+    size_t hid = m_schema.handlers.append(handler);
+    return NetEvent<ArgsTy...>(m_schema, channel, hid);
 }
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+
+// Channels of the game hosts, in the order they are added to the host
+enum GameChannel {
+    GameReliable = 0,
+    GameUnreliable = 1,
+};
+
+
+// Replicated state of a doll, shared by the game server and client
+struct GameDollState {
+    float position[3];
+    float yaw;
+    uint32_t flags;
+};
\ No newline at end of file
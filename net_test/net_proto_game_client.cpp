@@ -2,6 +2,7 @@
 #include "net_proto_game_client.h"
 
 #include "core/memory/string.h"
+#include <string.h>
 #include <stdio.h>
 
 
@@ -10,28 +11,32 @@
 // ----------------------------------------------------------------------------
 void NetProtocolGameClient::bind_reliable(NetHost& host)
 {
-    addHandler(host, this, &NetProtocolGameClient::load)
+    addHandler(host, this, M_NET_METHOD(NetProtocolGameClient, load))
         .name("GameClient").name("load");
 
-    addHandler(host, this, &NetProtocolGameClient::addDoll)
+    addHandler(host, this, M_NET_METHOD(NetProtocolGameClient, addDoll))
         .name("GameClient").name("addDoll");
 }
 
 // ----------------------------------------------------------------------------
 void NetProtocolGameClient::bind_unreliable(NetHost& host)
 {
-    addHandler(host, this, &NetProtocolGameClient::updateDoll)
-        .name("GameClient").name("updateDoll");
+    using namespace std::placeholders;
+
+    m_dolls.bind(host, GameUnreliable, "GameDoll");
+    m_dolls.onState = std::bind(&NetProtocolGameClient::updateDoll, this, _1, _2);
 }
 
 // ----------------------------------------------------------------------------
-void NetProtocolGameClient::load(NetConnection& conn, Data::String level)
+void NetProtocolGameClient::load(NetConnection& conn, NetView<Data::String> level)
 {
-    sendOnLevelLoaded = conn.event(0).name("GameServer").name("onLevelLoaded").get();
+    sendOnLevelLoaded = conn.event(GameReliable).name("GameServer").name("onLevelLoaded").get();
 
-    m_level = level;
+    // The level name is a view into the packet, keep an own copy
+    size_t length = Data::count(level);
+    memcpy(m_level.alloc(length), level.begin, length);
     m_server = conn.source();
-    printf("game client> load level: %s\n", Memory::ZtString(level).cstr());
+    printf("game client> load level: %s\n", m_level.cstr());
 
     onLevelLoaded();
 }
@@ -50,10 +55,10 @@ void NetProtocolGameClient::addDoll(NetConnection& ctx)
 }
 
 // ----------------------------------------------------------------------------
-void NetProtocolGameClient::updateDoll(NetConnection& ctx)
+void NetProtocolGameClient::updateDoll(NetConnection& ctx, GameDollState const& state)
 {
     // update doll entity
-    printf("game client> update doll\n");
+    printf("game client> update doll (yaw: %.2f)\n", state.yaw);
 }
 
 #endif // CLIENT
\ No newline at end of file
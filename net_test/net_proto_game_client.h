@@ -1,7 +1,10 @@
 #pragma once
 #ifdef CLIENT
 
-#include "core/data/string.h"
+#include "core/memory/string.h"
+
+#include "net_replication.h"
+#include "net_proto_game.h"
 #include "net_host.h"
 
 
@@ -10,17 +13,18 @@ public:
     void bind_reliable(NetHost& host);
     void bind_unreliable(NetHost& host);
 
-    void load(NetConnection& ctx, Data::String level);
+    void load(NetConnection& ctx, NetView<Data::String> level);
     void onLevelLoaded();
 
     void addDoll(NetConnection& ctx);
-    void updateDoll(NetConnection& ctx);
+    void updateDoll(NetConnection& ctx, GameDollState const& state);
 
 private:
     NetEvent<void> sendOnLevelLoaded;
+    NetReplicaReceiver<GameDollState> m_dolls;
 
     NetPeerId m_server;
-    Data::String m_level;
+    Memory::ZtString m_level;
 };
 
 #endif // CLIENT
\ No newline at end of file
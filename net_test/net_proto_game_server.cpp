@@ -8,31 +8,74 @@
 // ----------------------------------------------------------------------------
 void NetProtocolGameServer::bind_reliable(NetHost& host)
 {
-    addHandler(host, this, &NetProtocolGameServer::onLevelLoaded)
+    addHandler(host, this, M_NET_METHOD(NetProtocolGameServer, onLevelLoaded))
         .name("GameServer").name("onLevelLoaded");
 }
 
 // ----------------------------------------------------------------------------
 void NetProtocolGameServer::bind_unreliable(NetHost& host)
 {
+    m_doll = GameDollState();
+    m_dolls.bind(host, "GameDoll");
 }
 
 // ----------------------------------------------------------------------------
 void NetProtocolGameServer::onConnected(NetConnection& conn)
 {
-    load = conn.event(0).name("GameClient").name("load").get();
-    addDoll = conn.event(0).name("GameClient").name("addDoll").get();
-    updateDoll = conn.event(0).name("GameClient").name("updateDoll").get();
+    load = conn.event(GameReliable).name("GameClient").name("load").get();
+    addDoll = conn.event(GameReliable).name("GameClient").name("addDoll").get();
+    m_dolls.connect(conn, GameUnreliable, "GameDoll");
 
     printf("game server> connected new client (nonce: %zd)\n", conn.source().nonce);
     load(conn.source(), level);
 }
 
+// ----------------------------------------------------------------------------
+void NetProtocolGameServer::onDisconnected(NetPeerId peer)
+{
+    size_t i = find(peer);
+    if (i != SIZE_MAX) {
+        printf("game server> client disconnected (nonce: %zd)\n", peer.nonce);
+
+        Array<NetPeerId> clients = m_clients.asArray();
+        clients[i] = clients[Data::count(clients) - 1];
+        m_clients.pop();
+    }
+    m_dolls.disconnect(peer);
+}
+
 // ----------------------------------------------------------------------------
 void NetProtocolGameServer::onLevelLoaded(NetConnection& conn)
 {
     printf("game server> request to add new doll\n");
     addDoll(conn.source());
+
+    // Repeated requests must not list the client twice
+    if (find(conn.source()) == SIZE_MAX) {
+        m_clients.append(conn.source());
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetProtocolGameServer::update()
+{
+    m_doll.yaw += 0.1f;
+    m_doll.position[0] += 0.05f;
+
+    for (NetPeerId const& client : Data::iterate(m_clients.asArray())) {
+        m_dolls.send(client, m_doll);
+    }
+}
+
+// ----------------------------------------------------------------------------
+size_t NetProtocolGameServer::find(NetPeerId const& peer) const
+{
+    Array<NetPeerId> clients = m_clients.asArray();
+    for (size_t i = 0; i < Data::count(clients); ++i) {
+        NetPeerId const& client = clients[i];
+        if (client.index == peer.index && client.nonce == peer.nonce && client.shard == peer.shard) return i;
+    }
+    return SIZE_MAX;
 }
 
 #endif // SERVER
\ No newline at end of file
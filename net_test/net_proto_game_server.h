@@ -1,7 +1,11 @@
 #pragma once
 #ifdef SERVER
 
+#include "core/memory/containers.h"
 #include "core/data/string.h"
+
+#include "net_replication.h"
+#include "net_proto_game.h"
 #include "net_host.h"
 
 
@@ -13,13 +17,21 @@ public:
     void bind_unreliable(NetHost& host);
 
     void onConnected(NetConnection& conn);
+    void onDisconnected(NetPeerId peer);
     void onLevelLoaded(NetConnection& conn);
 
+    // Streams the doll state to every client with a loaded level
+    void update();
+
 private:
     NetEvent<Data::String> load;
-
     NetEvent<void> addDoll;
-    NetEvent<void> updateDoll;
+
+    NetReplicaSender<GameDollState> m_dolls;
+    Memory::RaStack<NetPeerId> m_clients;
+    GameDollState m_doll;
+
+    size_t find(NetPeerId const& peer) const;
 };
 
 
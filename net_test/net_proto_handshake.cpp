@@ -1,13 +1,29 @@
 #include "net_proto_handshake.h"
 
+#include <algorithm>
+
 
 // ----------------------------------------------------------------------------
 // NetProtocolHandshake implementation
 // ----------------------------------------------------------------------------
-void NetProtocolHandshake::bind(NetHost& host)
+NetProtocolHandshake::~NetProtocolHandshake()
+{
+    for (Cached* cached : Data::iterate(m_cached.asArray())) {
+        delete cached;
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetProtocolHandshake::bind(NetHost& host, NetHandshakeMode mode)
 {
-    doRequest = addAnonymous(host, 0, this, &NetProtocolHandshake::request);
-    onAccepted = addAnonymous(host, 0, this, &NetProtocolHandshake::finalize);
+    m_mode = mode;
+
+    // Every mode binds all handlers, so the anonymous ids do not depend on it
+    doRequest = addAnonymous(host, 0, this, M_NET_METHOD(NetProtocolHandshake, request));
+    onAccepted = addAnonymous(host, 0, this, M_NET_METHOD(NetProtocolHandshake, finalize));
+    doOffer = addAnonymous(host, 0, this, M_NET_METHOD(NetProtocolHandshake, offer));
+    doQuery = addAnonymous(host, 0, this, M_NET_METHOD(NetProtocolHandshake, query));
+    doTable = addAnonymous(host, 0, this, M_NET_METHOD(NetProtocolHandshake, table));
 
     using namespace std::placeholders;
     host.onConnected = std::bind(&NetProtocolHandshake::connect, this, _1, _2);
@@ -17,7 +33,25 @@ void NetProtocolHandshake::bind(NetHost& host)
 void NetProtocolHandshake::connect(NetPeerId peer, NetEventNames const& names)
 {
     printf("handshake> request connection\n");
-    doRequest(peer, names);
+    if (m_mode == NetHandshakeMode::Names) {
+        doRequest(peer, names);
+        return;
+    }
+
+    // Names do not change once the host is connected, they are hashed once
+    NetFingerprint fingerprint;
+    {
+        Data::MutexGuard guard = m_lock.guard();
+        if (m_local.isEmpty()) {
+            names.hashHandlers(m_local);
+            for (size_t i = 1; i < m_local.count(); ++i) {
+                M_ASSERT_MSG(m_local[i].hash != m_local[i - 1].hash, "Handler names collide");
+            }
+            m_fingerprint = NetEventNames::fingerprint(m_local.asArray());
+        }
+        fingerprint = m_fingerprint;
+    }
+    doOffer(peer, fingerprint);
 }
 
 // ----------------------------------------------------------------------------
@@ -26,7 +60,69 @@ void NetProtocolHandshake::request(NetConnection& conn, NetEventNames names)
     printf("handshake> connection accepted\n");
 
     NetPeerId peer = conn.source();
-    conn.setNames(peer, names);
+    if (!conn.setNames(peer, names)) return;
+    onAccepted(peer);
+}
+
+// ----------------------------------------------------------------------------
+void NetProtocolHandshake::offer(NetConnection& conn, NetFingerprint fingerprint)
+{
+    NetPeerId peer = conn.source();
+    {
+        Data::MutexGuard guard = m_lock.guard();
+        Cached* cached = find(fingerprint);
+        if (cached != nullptr) {
+            printf("handshake> connection accepted by fingerprint\n");
+            if (conn.setHashes(peer, cached->hashes.asArray())) {
+                onAccepted(peer);
+            }
+            return;
+        }
+    }
+    doQuery(peer);
+}
+
+// ----------------------------------------------------------------------------
+void NetProtocolHandshake::query(NetConnection& conn)
+{
+    Data::MutexGuard guard = m_lock.guard();
+    doTable(conn.source(), m_local.asArray());
+}
+
+// ----------------------------------------------------------------------------
+void NetProtocolHandshake::table(NetConnection& conn, NetCompact<Array<NetHandlerHash>> hashes)
+{
+    printf("handshake> connection accepted\n");
+
+    // The table lives in the frame arena, the remote order is not trusted
+    std::sort(hashes.begin, hashes.end, [](NetHandlerHash const& lhs, NetHandlerHash const& rhs) {
+        return lhs.hash < rhs.hash;
+    });
+
+    // Tables which cannot be routed are neither accepted nor cached
+    NetPeerId peer = conn.source();
+    if (!conn.setHashes(peer, hashes)) return;
+
+    // Peers of one build may query concurrently, their table is kept once
+    NetFingerprint fingerprint = NetEventNames::fingerprint(hashes);
+    {
+        Data::MutexGuard guard = m_lock.guard();
+        if (find(fingerprint) == nullptr) {
+            if (m_cached.count() == MaxCached) {
+                Array<Cached*> all = m_cached.asArray();
+                delete all[0];
+                memmove(all.begin, all.begin + 1, (MaxCached - 1) * sizeof(Cached*));
+                m_cached.pop();
+            }
+
+            Cached* cached = new Cached();
+            cached->fingerprint = fingerprint;
+            for (NetHandlerHash const& row : Data::iterate(hashes)) {
+                cached->hashes.append(row);
+            }
+            m_cached.append(cached);
+        }
+    }
     onAccepted(peer);
 }
 
@@ -34,5 +130,15 @@ void NetProtocolHandshake::request(NetConnection& conn, NetEventNames names)
 void NetProtocolHandshake::finalize(NetConnection& conn)
 {
     printf("handshake> connection syncronized\n");
+    conn.setSynchronized(conn.source());
     onConnected(conn);
+}
+
+// ----------------------------------------------------------------------------
+auto NetProtocolHandshake::find(NetFingerprint const& fingerprint) const -> Cached*
+{
+    for (Cached* cached : Data::iterate(m_cached.asArray())) {
+        if (cached->fingerprint == fingerprint) return cached;
+    }
+    return nullptr;
 }
\ No newline at end of file
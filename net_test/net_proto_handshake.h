@@ -1,20 +1,59 @@
 #pragma once
 
 #include "core/tools/event.h"
+#include "core/data/threading.h"
 #include "net_host.h"
 
 
+// What the handshake sends of the names, both ends must use the same mode
+enum class NetHandshakeMode {
+    Names,      // the whole NetEventNames tree
+    Hashed,     // a fingerprint, the handler hashes only if the remote has not cached them
+};
+
+
 class NetProtocolHandshake {
 public:
     Tools::Event<NetConnection&> onConnected;
 
-    void bind(NetHost& host);
+    NetProtocolHandshake() : m_mode(NetHandshakeMode::Names), m_fingerprint() {}
+    ~NetProtocolHandshake();
+
+    void bind(NetHost& host, NetHandshakeMode mode = NetHandshakeMode::Names);
 
     void connect(NetPeerId peer, NetEventNames const& names);
     void request(NetConnection& conn, NetEventNames events);
+    void offer(NetConnection& conn, NetFingerprint fingerprint);
+    void query(NetConnection& conn);
+    void table(NetConnection& conn, NetCompact<Array<NetHandlerHash>> hashes);
     void finalize(NetConnection& conn);
 
+private:
+    struct Cached {
+        NetFingerprint fingerprint;
+        Memory::RaStack<NetHandlerHash> hashes;
+    };
+
+    // Remote tables kept across connections, a restarted server is sent each
+    // client build's table once. Oldest are dropped first. They are keyed by
+    // the digest computed here, a remote cannot plant a table for another build.
+    static constexpr size_t MaxCached = 16;
+
 private:
     NetEvent<NetEventNames> doRequest;
+    NetEvent<NetFingerprint> doOffer;
+    NetEvent<void> doQuery;
+    NetEvent<NetCompact<Array<NetHandlerHash>>> doTable;
     NetEvent<void> onAccepted;
+
+    NetHandshakeMode m_mode;
+
+    // Handlers of all shards share the tables
+    Data::Mutex m_lock;
+    Memory::RaStack<NetHandlerHash> m_local;
+    NetFingerprint m_fingerprint;
+    Memory::RaStack<Cached*> m_cached;
+
+    // Called with the lock held
+    Cached* find(NetFingerprint const& fingerprint) const;
 };
\ No newline at end of file
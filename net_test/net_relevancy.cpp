@@ -0,0 +1,96 @@
+#include "net_relevancy.h"
+
+#include <math.h>
+
+
+using namespace Data;
+
+
+// ----------------------------------------------------------------------------
+// NetPeerSet implementation
+// ----------------------------------------------------------------------------
+void NetPeerSet::filter(CArray<NetPeerId> candidates, std::function<bool(NetPeerId const&)> const& relevant)
+{
+    for (NetPeerId const& peer : iterate(candidates)) {
+        if (relevant(peer)) {
+            m_peers.append(peer);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// NetSpatialGrid implementation
+// ----------------------------------------------------------------------------
+NetSpatialGrid::NetSpatialGrid(float cellSize, size_t buckets)
+    : m_cellSize(cellSize)
+{
+    M_ASSERT(cellSize > 0.0f);
+    M_ASSERT_MSG((buckets & (buckets - 1)) == 0, "Buckets count must be a power of two");
+
+    for (size_t i = 0; i < buckets; ++i) {
+        m_buckets.append(SIZE_MAX);
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetSpatialGrid::clear()
+{
+    for (size_t& head : iterate(m_buckets.asArray())) {
+        head = SIZE_MAX;
+    }
+    m_entries.reset();
+}
+
+// ----------------------------------------------------------------------------
+void NetSpatialGrid::place(NetPeerId const& peer, float x, float y)
+{
+    Entry entry;
+    entry.peer = peer;
+    entry.x = x;
+    entry.y = y;
+    entry.cellX = cell(x);
+    entry.cellY = cell(y);
+
+    size_t& head = m_buckets[bucket(entry.cellX, entry.cellY)];
+    entry.next = head;
+    head = m_entries.append(entry);
+}
+
+// ----------------------------------------------------------------------------
+void NetSpatialGrid::query(float x, float y, float radius, NetPeerSet& out) const
+{
+    float radiusSq = radius * radius;
+
+    int32_t minX = cell(x - radius), maxX = cell(x + radius);
+    int32_t minY = cell(y - radius), maxY = cell(y + radius);
+    for (int32_t cellY = minY; cellY <= maxY; ++cellY) {
+        for (int32_t cellX = minX; cellX <= maxX; ++cellX) {
+            // Buckets are shared by distant cells, entries are checked by their cell
+            size_t index = m_buckets[bucket(cellX, cellY)];
+            while (index != SIZE_MAX) {
+                Entry const& entry = m_entries[index];
+                index = entry.next;
+
+                if (entry.cellX != cellX || entry.cellY != cellY) continue;
+
+                float dx = entry.x - x, dy = entry.y - y;
+                if (dx * dx + dy * dy <= radiusSq) {
+                    out.add(entry.peer);
+                }
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+int32_t NetSpatialGrid::cell(float coord) const
+{
+    return (int32_t)floorf(coord / m_cellSize);
+}
+
+// ----------------------------------------------------------------------------
+size_t NetSpatialGrid::bucket(int32_t cellX, int32_t cellY) const
+{
+    uint32_t hash = (uint32_t)cellX * 73856093u ^ (uint32_t)cellY * 19349663u;
+    return hash & (m_buckets.count() - 1);
+}
\ No newline at end of file
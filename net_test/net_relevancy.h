@@ -0,0 +1,55 @@
+#pragma once
+
+#include "core/memory/containers.h"
+#include "core/data/array.h"
+
+#include "net_transport.h"
+
+#include <functional>
+
+
+// Peers an event is relevant for, target of a NetBroadcast
+class NetPeerSet {
+public:
+    void clear() { m_peers.reset(); }
+    void add(NetPeerId const& peer) { m_peers.append(peer); }
+
+    // Adds the candidates accepted by the relevancy callback
+    void filter(Data::CArray<NetPeerId> candidates, std::function<bool(NetPeerId const&)> const& relevant);
+
+    Data::CArray<NetPeerId> peers() const { return m_peers.asArray(); }
+    operator Data::CArray<NetPeerId>() const { return peers(); }
+
+private:
+    Memory::RaStack<NetPeerId> m_peers;
+};
+
+
+// Uniform grid over the horizontal plane, rebuilt every tick from the peers'
+// positions and queried for the peers around an event
+class NetSpatialGrid {
+public:
+    NetSpatialGrid(float cellSize, size_t buckets = 256);
+
+    void clear();
+    void place(NetPeerId const& peer, float x, float y);
+
+    // Adds the peers within the radius around the point
+    void query(float x, float y, float radius, NetPeerSet& out) const;
+
+private:
+    struct Entry {
+        NetPeerId peer;
+        float x, y;
+        int32_t cellX, cellY;
+        size_t next;
+    };
+
+private:
+    float m_cellSize;
+    Memory::RaStack<size_t> m_buckets;
+    Memory::RaStack<Entry> m_entries;
+
+    int32_t cell(float coord) const;
+    size_t bucket(int32_t cellX, int32_t cellY) const;
+};
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "net_replication.h"
+
+
+using namespace Data;
+
+
+// ----------------------------------------------------------------------------
+// NetDeltaCodec implementation
+// ----------------------------------------------------------------------------
+void NetDeltaCodec::encode(Memory::RegBuffer& data, CBytes baseline, CBytes state)
+{
+    M_ASSERT(count(baseline) == count(state));
+
+    // Pairs of (zeros to skip, literal count) followed by the literal XOR bytes,
+    // a literal run ends only at two zeros, a single zero is cheaper to keep
+    size_t length = count(state);
+    size_t pos = 0;
+    while (pos < length) {
+        size_t zeros = pos;
+        while (zeros < length && baseline[zeros] == state[zeros]) ++zeros;
+
+        size_t literals = zeros;
+        while (literals < length) {
+            if (baseline[literals] != state[literals]) { ++literals; continue; }
+            if (literals + 1 < length && baseline[literals + 1] != state[literals + 1]) { literals += 2; continue; }
+            break;
+        }
+
+        if (literals == zeros) break;
+
+        writeVarint(data, zeros - pos);
+        writeVarint(data, literals - zeros);
+
+        Bytes out = data.reserve(literals - zeros);
+        for (size_t i = zeros; i < literals; ++i) {
+            out[i - zeros] = baseline[i] ^ state[i];
+        }
+        pos = literals;
+    }
+}
+
+// ----------------------------------------------------------------------------
+bool NetDeltaCodec::decode(CBytes baseline, CBytes delta, Bytes state)
+{
+    M_ASSERT(count(baseline) == count(state));
+
+    bytecopy(state, baseline);
+
+    size_t length = count(state);
+    size_t pos = 0;
+    while (!isEmpty(delta)) {
+        uint64_t zeros = 0, literals = 0;
+        if (!readVarint(delta, &zeros)) return false;
+        if (!readVarint(delta, &literals)) return false;
+
+        // Compared against the room left, a forged run cannot wrap pos around
+        if (zeros > length - pos) return false;
+        pos += (size_t)zeros;
+        if (literals > length - pos || count(delta) < literals) return false;
+
+        for (size_t i = 0; i < literals; ++i) {
+            state[pos + i] ^= delta[i];
+        }
+        delta.begin += literals;
+        pos += (size_t)literals;
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "core/memory/containers.h"
+#include "core/data/array.h"
+
+#include "net_host.h"
+
+#include <type_traits>
+
+
+// Sequence numbers of snapshots, zero marks a full snapshot without baseline
+using NetSequence = uint32_t;
+
+
+// Delta of two states: XOR of their bytes with runs of zeros skipped
+struct NetDeltaCodec {
+    static void encode(Memory::RegBuffer& data, CBytes baseline, CBytes state);
+    static bool decode(CBytes baseline, CBytes delta, Bytes state);
+};
+
+
+// Sending side of a replicated state. Every peer gets deltas against the last
+// snapshot it acknowledged, or a full snapshot when that one is too old.
+template <class T, size_t Window = 32>
+class NetReplicaSender {
+    static_assert(std::is_trivially_copyable<T>::value, "Replicated state must be trivially copyable");
+public:
+    ~NetReplicaSender();
+
+    // Registers the <name>.ack handler
+    void bind(NetHost& host, char const* name);
+
+    // Resolves the <name>.snapshot handler of the connection source
+    void connect(NetConnection& conn, size_t channel, char const* name);
+
+    void send(NetPeerId const& peer, T const& state);
+
+    // Forgets the peer, a later peer in its slot starts from a full snapshot
+    void disconnect(NetPeerId const& peer);
+
+private:
+    struct Link {
+        NetEvent<NetVarint<NetSequence>, NetVarint<NetSequence>, NetView<Array<Data::Byte>>> snapshot;
+        size_t nonce;
+
+        NetSequence sequence;
+        NetSequence acked;
+
+        NetSequence sent[Window];
+        T states[Window];
+    };
+
+private:
+    Memory::RaStack<Memory::RaStack<Link>> m_links;
+    Memory::RegBuffer m_scratch;
+
+    Link& link(NetPeerId const& peer);
+    void ack(NetConnection& conn, NetVarint<NetSequence> sequence);
+};
+
+
+// Receiving side of a replicated state, acknowledges every applied snapshot
+template <class T, size_t Window = 32>
+class NetReplicaReceiver {
+    static_assert(std::is_trivially_copyable<T>::value, "Replicated state must be trivially copyable");
+public:
+    std::function<void(NetConnection&, T const&)> onState;
+
+    ~NetReplicaReceiver();
+
+    // Registers the <name>.snapshot handler, the sender must bind <name>.ack
+    void bind(NetHost& host, size_t channel, char const* name);
+
+private:
+    struct Link {
+        NetEvent<NetVarint<NetSequence>> ack;
+        size_t nonce;
+
+        NetSequence latest;
+        NetSequence received[Window];
+        T states[Window];
+    };
+
+private:
+    Memory::RaStack<Memory::RaStack<Link>> m_links;
+    char const* m_name;
+    size_t m_channel;
+
+    Link& link(NetConnection& conn);
+    void snapshot(NetConnection& conn, NetVarint<NetSequence> sequence,
+        NetVarint<NetSequence> baseline, NetView<Array<Data::Byte>> payload);
+};
+
+
+#include "net_replication.hpp"
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "net_replication.h"
+
+
+// ----------------------------------------------------------------------------
+// NetReplicaSender implementation
+// ----------------------------------------------------------------------------
+template <class T, size_t Window>
+NetReplicaSender<T, Window>::~NetReplicaSender()
+{
+    for (Memory::RaStack<Link>& links : Data::iterate(m_links.asArray())) {
+        links.~RaStack();
+    }
+}
+
+// ----------------------------------------------------------------------------
+template <class T, size_t Window>
+void NetReplicaSender<T, Window>::bind(NetHost& host, char const* name)
+{
+    addHandler(host, this, M_NET_METHOD(NetReplicaSender, ack))
+        .name(name).name("ack");
+}
+
+// ----------------------------------------------------------------------------
+template <class T, size_t Window>
+void NetReplicaSender<T, Window>::connect(NetConnection& conn, size_t channel, char const* name)
+{
+    Link& target = link(conn.source());
+    target.snapshot = conn.event(channel).name(name).name("snapshot").get();
+}
+
+// ----------------------------------------------------------------------------
+template <class T, size_t Window>
+void NetReplicaSender<T, Window>::send(NetPeerId const& peer, T const& state)
+{
+    Link& target = link(peer);
+
+    NetSequence sequence = ++target.sequence;
+    if (sequence == 0) {
+        sequence = ++target.sequence;
+    }
+
+    // The acked snapshot must still be in the window, otherwise send everything
+    NetSequence baseline = target.acked;
+    bool delta = (baseline != 0)
+        && (NetSequence)(sequence - baseline) < Window
+        && target.sent[baseline % Window] == baseline;
+
+    m_scratch.reset();
+    if (delta) {
+        NetDeltaCodec::encode(m_scratch, Data::toBytes(&target.states[baseline % Window]), Data::toBytes(&state));
+    }
+    else {
+        Data::write(&m_scratch.reserve(sizeof(T)), Data::toBytes(&state));
+        baseline = 0;
+    }
+
+    target.sent[sequence % Window] = sequence;
+    target.states[sequence % Window] = state;
+
+    CBytes payload{ m_scratch.memory.begin, m_scratch.memory.begin + m_scratch.size() };
+    target.snapshot(peer, sequence, baseline, payload);
+}
+
+// ----------------------------------------------------------------------------
+template <class T, size_t Window>
+void NetReplicaSender<T, Window>::disconnect(NetPeerId const& peer)
+{
+    if (m_links.count() <= peer.shard || m_links[peer.shard].count() <= peer.index) {
+        return;
+    }
+
+    Link& target = m_links[peer.shard][peer.index];
+    if (target.nonce == peer.nonce) {
+        memset(&target, 0, sizeof(Link));
+        target.nonce = -1;
+    }
+}
+
+// ----------------------------------------------------------------------------
+template <class T, size_t Window>
+void NetReplicaSender<T, Window>::ack(NetConnection& conn, NetVarint<NetSequence> sequence)
+{
+    Link& target = link(conn.source());
+
+    // Acks are unreliable, late ones must not move the baseline back
+    bool newer = (target.acked == 0) || (int32_t)(sequence.value - target.acked) > 0;
+    if (newer && target.sent[sequence.value % Window] == sequence.value) {
+        target.acked = sequence.value;
+    }
+}
+
+// ----------------------------------------------------------------------------
+template <class T, size_t Window>
+auto NetReplicaSender<T, Window>::link(NetPeerId const& peer) -> Link&
+{
+    while (m_links.count() <= peer.shard) {
+        m_links.append();
+    }
+
+    Memory::RaStack<Link>& links = m_links[peer.shard];
+    while (links.count() <= peer.index) {
+        Link* fresh = links.alloc();
+        memset(fresh, 0, sizeof(Link));
+        fresh->nonce = -1;
+    }
+
+    // Peer slots are reused, a new nonce starts from a full snapshot
+    Link& target = links[peer.index];
+    if (target.nonce != peer.nonce) {
+        memset(&target, 0, sizeof(Link));
+        target.nonce = peer.nonce;
+    }
+    return target;
+}
+
+// ----------------------------------------------------------------------------
+// NetReplicaReceiver implementation
+// ----------------------------------------------------------------------------
+template <class T, size_t Window>
+NetReplicaReceiver<T, Window>::~NetReplicaReceiver()
+{
+    for (Memory::RaStack<Link>& links : Data::iterate(m_links.asArray())) {
+        links.~RaStack();
+    }
+}
+
+// ----------------------------------------------------------------------------
+template <class T, size_t Window>
+void NetReplicaReceiver<T, Window>::bind(NetHost& host, size_t channel, char const* name)
+{
+    m_name = name;
+    m_channel = channel;
+
+    addHandler(host, this, M_NET_METHOD(NetReplicaReceiver, snapshot))
+        .name(name).name("snapshot");
+}
+
+// ----------------------------------------------------------------------------
+template <class T, size_t Window>
+void NetReplicaReceiver<T, Window>::snapshot(NetConnection& conn, NetVarint<NetSequence> sequence,
+    NetVarint<NetSequence> baseline, NetView<Array<Data::Byte>> payload)
+{
+    Link& source = link(conn);
+
+    // Snapshots are unsequenced, anything older than the applied one is dropped
+    if (source.latest != 0 && (int32_t)(sequence.value - source.latest) <= 0) {
+        return;
+    }
+
+    T state;
+    if (baseline.value == 0) {
+        if (Data::count(payload) != sizeof(T)) return;
+        Data::bytecopy(Data::toBytes(&state), payload);
+    }
+    else {
+        if (source.received[baseline.value % Window] != baseline.value) return;
+
+        T const& base = source.states[baseline.value % Window];
+        if (!NetDeltaCodec::decode(Data::toBytes(&base), payload, Data::toBytes(&state))) return;
+    }
+
+    source.latest = sequence.value;
+    source.received[sequence.value % Window] = sequence.value;
+    source.states[sequence.value % Window] = state;
+
+    source.ack(conn.source(), sequence);
+    if (onState) {
+        onState(conn, state);
+    }
+}
+
+// ----------------------------------------------------------------------------
+template <class T, size_t Window>
+auto NetReplicaReceiver<T, Window>::link(NetConnection& conn) -> Link&
+{
+    NetPeerId peer = conn.source();
+    while (m_links.count() <= peer.shard) {
+        m_links.append();
+    }
+
+    Memory::RaStack<Link>& links = m_links[peer.shard];
+    while (links.count() <= peer.index) {
+        Link* fresh = links.alloc();
+        memset(fresh, 0, sizeof(Link));
+        fresh->nonce = -1;
+    }
+
+    Link& source = links[peer.index];
+    if (source.nonce != peer.nonce) {
+        memset(&source, 0, sizeof(Link));
+        source.nonce = peer.nonce;
+        source.ack = conn.event(m_channel).name(m_name).name("ack").get();
+    }
+    return source;
+}
\ No newline at end of file
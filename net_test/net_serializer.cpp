@@ -0,0 +1,96 @@
+#include "net_serializer.h"
+
+
+using namespace Data;
+
+
+// ----------------------------------------------------------------------------
+// Varints implementation
+// ----------------------------------------------------------------------------
+void writeVarint(Memory::RegBuffer& data, uint64_t value)
+{
+    Byte encoded[10];
+    size_t length = 0;
+
+    while (value >= 0x80) {
+        encoded[length++] = (Byte)(value | 0x80);
+        value >>= 7;
+    }
+    encoded[length++] = (Byte)value;
+
+    write(&data.reserve(length), toBytes((void const*)encoded, length));
+}
+
+// ----------------------------------------------------------------------------
+bool readVarint(CBytes& data, uint64_t* value)
+{
+    uint64_t result = 0;
+    for (size_t shift = 0; shift < 64; shift += 7) {
+        Byte byte;
+        if (!read(&data, &byte)) return false;
+
+        result |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+// NetBitWriter implementation
+// ----------------------------------------------------------------------------
+void NetBitWriter::write(uint64_t value, size_t bits)
+{
+    M_ASSERT(bits <= 32);
+
+    m_bits |= (value & ((uint64_t(1) << bits) - 1)) << m_count;
+    m_count += bits;
+
+    while (m_count >= 8) {
+        Data::write(&m_data.reserve(1), (Byte)m_bits);
+        m_bits >>= 8;
+        m_count -= 8;
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetBitWriter::flush()
+{
+    if (m_count != 0) {
+        Data::write(&m_data.reserve(1), (Byte)m_bits);
+    }
+    m_bits = 0;
+    m_count = 0;
+}
+
+// ----------------------------------------------------------------------------
+// NetBitReader implementation
+// ----------------------------------------------------------------------------
+uint64_t NetBitReader::read(size_t bits)
+{
+    M_ASSERT(bits <= 32);
+
+    while (m_count < bits) {
+        Byte byte = 0;
+        if (!Data::read(&m_data, &byte)) {
+            rejectInput(m_data);
+        }
+
+        m_bits |= uint64_t(byte) << m_count;
+        m_count += 8;
+    }
+
+    uint64_t value = m_bits & ((uint64_t(1) << bits) - 1);
+    m_bits >>= bits;
+    m_count -= bits;
+    return value;
+}
+
+// ----------------------------------------------------------------------------
+void NetBitReader::flush()
+{
+    m_bits = 0;
+    m_count = 0;
+}
\ No newline at end of file
@@ -0,0 +1,325 @@
+#pragma once
+
+#include "core/data/array.h"
+#include "core/memory/plain.h"
+#include "core/tools/utils.h"
+#include "core/math/common.h"
+
+#include <type_traits>
+#include <stddef.h>
+
+
+using Data::Array;
+using Data::Bytes;
+using Data::CBytes;
+
+
+namespace Serializer {
+    struct Plain {};
+
+    struct Int32 {};
+    struct Int64 {};
+
+    struct String {};
+    struct ZtString {};
+
+    template <class K, class V>
+    struct HashMapRow {};
+
+    template <class K, class V>
+    struct HashMapPair {};
+}
+
+
+// LEB128 varints of the compact wire encoding
+void writeVarint(Memory::RegBuffer& data, uint64_t value);
+bool readVarint(CBytes& data, uint64_t* value);
+
+// Short or invalid input is rejected by nulling the view, so every later read
+// fails without a check of its own. Receivers test the view once per message.
+inline void rejectInput(CBytes& data) { data = CBytes(); }
+inline bool isRejected(CBytes const& data) { return data.begin == nullptr; }
+
+
+// Packs values narrower than a byte back to back, least significant bit first
+class NetBitWriter {
+public:
+    NetBitWriter(Memory::RegBuffer& data) : m_data(data), m_bits(0), m_count(0) {}
+
+    void write(uint64_t value, size_t bits);
+    void flush();
+
+private:
+    Memory::RegBuffer& m_data;
+    uint64_t m_bits;
+    size_t m_count;
+};
+
+class NetBitReader {
+public:
+    NetBitReader(CBytes& data) : m_data(data), m_bits(0), m_count(0) {}
+
+    uint64_t read(size_t bits);
+    void flush();
+
+private:
+    CBytes& m_data;
+    uint64_t m_bits;
+    size_t m_count;
+};
+
+
+// Compact wire types, wrap a handler argument or a field to change its encoding
+template <class T>
+struct NetVarint {
+    T value;
+
+public:
+    NetVarint(T value = T()) : value(value) {}
+    operator T() const { return value; }
+};
+
+// Unsigned value of the given bit width, e.g. a small enum
+template <class T, size_t Bits>
+struct NetBits {
+    T value;
+
+public:
+    NetBits(T value = T()) : value(value) {}
+    operator T() const { return value; }
+};
+
+// Float in [Min, Max] quantized to the given bit width
+template <int Min, int Max, size_t Bits>
+struct NetQuantized {
+    float value;
+
+public:
+    NetQuantized(float value = 0.0f) : value(value) {}
+    operator float() const { return value; }
+};
+
+
+// Member description for the generated serializers, see M_NET_FIELD
+template <class ClsTy, class T, size_t Offset>
+struct NetField {
+    using Class = ClsTy;
+    using Type = T;
+
+    static constexpr size_t offset = Offset;
+};
+
+template <class... FieldsTy>
+struct NetFieldList {};
+
+// Serialized members of a type, void means the type is sent as its memory image
+template <class T>
+struct NetFields {
+    using type = void;
+};
+
+#define M_NET_FIELD(CLS, NAME) \
+    NetField<CLS, decltype(CLS::NAME), offsetof(CLS, NAME)>
+
+#define M_NET_FIELDS(CLS, ...) \
+    template <> struct NetFields<CLS> { using type = NetFieldList<__VA_ARGS__>; }
+
+
+template <class T>
+struct NetPlainSerializer;
+
+template <class T, class FieldsTy>
+struct NetStructSerializer;
+
+
+// Types without own specialization are serialized by their field list or,
+// when there is none, as a raw memory image
+template <class T>
+struct NetSerializer
+    : public NetStructSerializer<T, typename NetFields<T>::type>
+{
+};
+
+// Trivially copyable types which are serialized as their memory image
+template <class T>
+struct NetIsPlain
+    : public std::is_base_of<NetPlainSerializer<T>, NetSerializer<T>>
+{
+};
+
+// Fewest bytes a value takes on the wire, zero when it is not known. Messages
+// shorter than the sum over their arguments are rejected before unpacking.
+template <class T>
+struct NetMinSize;
+
+template <class T, class FieldsTy>
+struct NetStructMinSize;
+
+template <class... TypesTy>
+struct NetMinSizeSum {
+    static constexpr size_t value = 0;
+};
+
+template <class T, class... TailTy>
+struct NetMinSizeSum<T, TailTy...> {
+    static constexpr size_t value = NetMinSize<T>::value + NetMinSizeSum<TailTy...>::value;
+};
+
+template <class T>
+struct NetMinSize
+    : public NetStructMinSize<T, typename NetFields<T>::type>
+{
+};
+
+template <class T>
+struct NetStructMinSize<T, void> {
+    static constexpr size_t value = NetIsPlain<T>::value ? sizeof(T) : 0;
+};
+
+template <class T, class... FieldsTy>
+struct NetStructMinSize<T, NetFieldList<FieldsTy...>>
+    : public NetMinSizeSum<typename FieldsTy::Type...>
+{
+};
+
+template <class T>
+struct NetMinSize<NetVarint<T>> {
+    static constexpr size_t value = 1;
+};
+
+// Base of serializers which also pack through a bit writer, consecutive
+// arguments of such types share bytes
+struct NetBitSerializer {};
+
+template <class T>
+struct NetIsBitwise
+    : public std::is_base_of<NetBitSerializer, NetSerializer<T>>
+{
+};
+
+
+template <class T>
+struct NetPlainSerializer {
+    static void pack(Memory::RegBuffer& data, T const& value);
+    static T unpack(Memory::IAllocator& alloc, CBytes& data);
+};
+
+template <class T>
+struct NetStructSerializer<T, void>
+    : public NetPlainSerializer<T>
+{
+};
+
+template <class T, class... FieldsTy>
+struct NetStructSerializer<T, NetFieldList<FieldsTy...>> {
+    static void pack(Memory::RegBuffer& data, T const& value);
+    static T unpack(Memory::IAllocator& alloc, CBytes& data);
+};
+
+
+// Tags serialization, the value type is given by the caller
+template <>
+struct NetSerializer<Serializer::Plain> {
+    template <class T>
+    static void pack(Memory::RegBuffer& data, T const& value);
+
+    template <class T>
+    static T unpack(Memory::IAllocator& alloc, CBytes& data);
+};
+
+template <>
+struct NetSerializer<Serializer::Int32> {
+    template <class T>
+    static void pack(Memory::RegBuffer& data, T const& value);
+
+    template <class T>
+    static T unpack(Memory::IAllocator& alloc, CBytes& data);
+};
+
+template <>
+struct NetSerializer<Serializer::Int64> {
+    template <class T>
+    static void pack(Memory::RegBuffer& data, T const& value);
+
+    template <class T>
+    static T unpack(Memory::IAllocator& alloc, CBytes& data);
+};
+
+
+template <class T>
+struct NetSerializer<NetVarint<T>> {
+    static void pack(Memory::RegBuffer& data, NetVarint<T> const& value);
+    static NetVarint<T> unpack(Memory::IAllocator& alloc, CBytes& data);
+};
+
+template <class T, size_t Bits>
+struct NetSerializer<NetBits<T, Bits>>
+    : public NetBitSerializer
+{
+    static_assert(Bits > 0 && Bits <= 32, "Bit width is out of range");
+
+    static void pack(NetBitWriter& bits, NetBits<T, Bits> const& value);
+    static NetBits<T, Bits> unpack(NetBitReader& bits);
+
+    static void pack(Memory::RegBuffer& data, NetBits<T, Bits> const& value);
+    static NetBits<T, Bits> unpack(Memory::IAllocator& alloc, CBytes& data);
+};
+
+template <int Min, int Max, size_t Bits>
+struct NetSerializer<NetQuantized<Min, Max, Bits>>
+    : public NetBitSerializer
+{
+    static_assert(Min < Max, "Quantization range is empty");
+    static_assert(Bits > 0 && Bits <= 32, "Bit width is out of range");
+
+    static void pack(NetBitWriter& bits, NetQuantized<Min, Max, Bits> const& value);
+    static NetQuantized<Min, Max, Bits> unpack(NetBitReader& bits);
+
+    static void pack(Memory::RegBuffer& data, NetQuantized<Min, Max, Bits> const& value);
+    static NetQuantized<Min, Max, Bits> unpack(Memory::IAllocator& alloc, CBytes& data);
+};
+
+
+// Unpacks a container element, tags are told the element type explicitly
+template <class T>
+struct NetElementSerializer {
+    template <class ElemTy>
+    static ElemTy unpack(Memory::IAllocator& alloc, CBytes& data) { return NetSerializer<T>::unpack(alloc, data); }
+};
+
+template <>
+struct NetElementSerializer<Serializer::Plain> {
+    template <class ElemTy>
+    static ElemTy unpack(Memory::IAllocator& alloc, CBytes& data) { return NetSerializer<Serializer::Plain>::unpack<ElemTy>(alloc, data); }
+};
+
+template <>
+struct NetElementSerializer<Serializer::Int32> {
+    template <class ElemTy>
+    static ElemTy unpack(Memory::IAllocator& alloc, CBytes& data) { return NetSerializer<Serializer::Int32>::unpack<ElemTy>(alloc, data); }
+};
+
+template <>
+struct NetElementSerializer<Serializer::Int64> {
+    template <class ElemTy>
+    static ElemTy unpack(Memory::IAllocator& alloc, CBytes& data) { return NetSerializer<Serializer::Int64>::unpack<ElemTy>(alloc, data); }
+};
+
+
+// Handler argument, consecutive bitwise arguments share a bit writer
+template <class T, bool Bitwise = NetIsBitwise<T>::value>
+struct NetArgument {
+    template <class ValueTy>
+    static void pack(NetBitWriter& bits, Memory::RegBuffer& data, ValueTy const& value);
+    static T unpack(NetBitReader& bits, Memory::IAllocator& alloc, CBytes& data);
+};
+
+template <class T>
+struct NetArgument<T, true> {
+    template <class ValueTy>
+    static void pack(NetBitWriter& bits, Memory::RegBuffer& data, ValueTy const& value);
+    static T unpack(NetBitReader& bits, Memory::IAllocator& alloc, CBytes& data);
+};
+
+
+#include "net_serializer.hpp"
\ No newline at end of file
@@ -0,0 +1,336 @@
+#include "net_serializer.h"
+
+
+// Bytes [Begin, End) of an object, copied as one block
+template <size_t Begin, size_t End>
+struct NetFieldCopy {
+    template <class T>
+    static void pack(Memory::RegBuffer& data, T const& value)
+    {
+        Data::write(&data.reserve(End - Begin), Data::toBytes((Data::Byte const*)&value + Begin, End - Begin));
+    }
+
+    template <class T>
+    static void unpack(Memory::IAllocator& alloc, CBytes& data, T& value)
+    {
+        if (!Data::read(&data, Data::toBytes((Data::Byte*)&value + Begin, End - Begin))) {
+            rejectInput(data);
+        }
+    }
+};
+
+// Field with its own serializer
+template <class FieldTy>
+struct NetFieldCall {
+    using Type = typename FieldTy::Type;
+
+    template <class T>
+    static void pack(Memory::RegBuffer& data, T const& value)
+    {
+        Type const& field = *(Type const*)((Data::Byte const*)&value + FieldTy::offset);
+        NetSerializer<Type>::pack(data, field);
+    }
+
+    template <class T>
+    static void unpack(Memory::IAllocator& alloc, CBytes& data, T& value)
+    {
+        // Containers are told their own type, as handler arguments are
+        Type& field = *(Type*)((Data::Byte*)&value + FieldTy::offset);
+        field = NetElementSerializer<Type>::template unpack<Type>(alloc, data);
+    }
+};
+
+template <class... OpsTy>
+struct NetFieldOps {
+    template <class T>
+    static void pack(Memory::RegBuffer& data, T const& value)
+    {
+        using expand_type = int[];
+        expand_type{ 0, (OpsTy::pack(data, value), 0)... };
+    }
+
+    template <class T>
+    static void unpack(Memory::IAllocator& alloc, CBytes& data, T& value)
+    {
+        using expand_type = int[];
+        expand_type{ 0, (OpsTy::unpack(alloc, data, value), 0)... };
+    }
+};
+
+
+// Appends an operation, empty copies are dropped
+template <class OpsTy, class OpTy>
+struct NetFieldAppend;
+
+template <class... OpsTy, class OpTy>
+struct NetFieldAppend<NetFieldOps<OpsTy...>, OpTy> {
+    using type = NetFieldOps<OpsTy..., OpTy>;
+};
+
+template <class... OpsTy, size_t Offset>
+struct NetFieldAppend<NetFieldOps<OpsTy...>, NetFieldCopy<Offset, Offset>> {
+    using type = NetFieldOps<OpsTy...>;
+};
+
+
+// Folds a field list into operations: adjacent plain fields without padding
+// between them extend the current copy, any other field closes it
+template <class OpsTy, class RunTy, class... FieldsTy>
+struct NetFieldMerge {
+    using type = typename NetFieldAppend<OpsTy, RunTy>::type;
+};
+
+template <bool Plain, bool Adjacent, class OpsTy, class RunTy, class FieldTy, class... TailTy>
+struct NetFieldMergeStep;
+
+template <class OpsTy, size_t Begin, size_t End, class FieldTy, class... TailTy>
+struct NetFieldMerge<OpsTy, NetFieldCopy<Begin, End>, FieldTy, TailTy...>
+    : public NetFieldMergeStep<NetIsPlain<typename FieldTy::Type>::value, FieldTy::offset == End,
+        OpsTy, NetFieldCopy<Begin, End>, FieldTy, TailTy...>
+{
+};
+
+template <class OpsTy, size_t Begin, size_t End, class FieldTy, class... TailTy>
+struct NetFieldMergeStep<true, true, OpsTy, NetFieldCopy<Begin, End>, FieldTy, TailTy...>
+    : public NetFieldMerge<OpsTy, NetFieldCopy<Begin, End + sizeof(typename FieldTy::Type)>, TailTy...>
+{
+};
+
+template <class OpsTy, size_t Begin, size_t End, class FieldTy, class... TailTy>
+struct NetFieldMergeStep<true, false, OpsTy, NetFieldCopy<Begin, End>, FieldTy, TailTy...>
+    : public NetFieldMerge<
+        typename NetFieldAppend<OpsTy, NetFieldCopy<Begin, End>>::type,
+        NetFieldCopy<FieldTy::offset, FieldTy::offset + sizeof(typename FieldTy::Type)>, TailTy...>
+{
+};
+
+template <bool Adjacent, class OpsTy, size_t Begin, size_t End, class FieldTy, class... TailTy>
+struct NetFieldMergeStep<false, Adjacent, OpsTy, NetFieldCopy<Begin, End>, FieldTy, TailTy...>
+    : public NetFieldMerge<
+        typename NetFieldAppend<typename NetFieldAppend<OpsTy, NetFieldCopy<Begin, End>>::type, NetFieldCall<FieldTy>>::type,
+        NetFieldCopy<0, 0>, TailTy...>
+{
+};
+
+
+// ----------------------------------------------------------------------------
+template <class T>
+void NetPlainSerializer<T>::pack(Memory::RegBuffer& data, T const& value)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "NetSerializer not instanced for this type");
+    Data::write(&data.reserve(sizeof(T)), value);
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+T NetPlainSerializer<T>::unpack(Memory::IAllocator& alloc, CBytes& data)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "NetSerializer not instanced for this type");
+
+    T value;
+    if (!Data::read(&data, &value)) {
+        rejectInput(data);
+    }
+    return value;
+}
+
+// ----------------------------------------------------------------------------
+template <class T, class... FieldsTy>
+void NetStructSerializer<T, NetFieldList<FieldsTy...>>::pack(Memory::RegBuffer& data, T const& value)
+{
+    using Ops = typename NetFieldMerge<NetFieldOps<>, NetFieldCopy<0, 0>, FieldsTy...>::type;
+    Ops::pack(data, value);
+}
+
+// ----------------------------------------------------------------------------
+template <class T, class... FieldsTy>
+T NetStructSerializer<T, NetFieldList<FieldsTy...>>::unpack(Memory::IAllocator& alloc, CBytes& data)
+{
+    using Ops = typename NetFieldMerge<NetFieldOps<>, NetFieldCopy<0, 0>, FieldsTy...>::type;
+
+    T value;
+    Ops::unpack(alloc, data, value);
+    return value;
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+void NetSerializer<Serializer::Plain>::pack(Memory::RegBuffer& data, T const& value)
+{
+    NetPlainSerializer<T>::pack(data, value);
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+T NetSerializer<Serializer::Plain>::unpack(Memory::IAllocator& alloc, CBytes& data)
+{
+    return NetPlainSerializer<T>::unpack(alloc, data);
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+void NetSerializer<Serializer::Int32>::pack(Memory::RegBuffer& data, T const& value)
+{
+    Data::write(&data.reserve(sizeof(int32_t)), (int32_t)value);
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+T NetSerializer<Serializer::Int32>::unpack(Memory::IAllocator& alloc, CBytes& data)
+{
+    int32_t value = 0;
+    if (!Data::read(&data, &value)) {
+        rejectInput(data);
+    }
+    return (T)value;
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+void NetSerializer<Serializer::Int64>::pack(Memory::RegBuffer& data, T const& value)
+{
+    Data::write(&data.reserve(sizeof(int64_t)), (int64_t)value);
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+T NetSerializer<Serializer::Int64>::unpack(Memory::IAllocator& alloc, CBytes& data)
+{
+    int64_t value = 0;
+    if (!Data::read(&data, &value)) {
+        rejectInput(data);
+    }
+    return (T)value;
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+void NetSerializer<NetVarint<T>>::pack(Memory::RegBuffer& data, NetVarint<T> const& value)
+{
+    // Signed values are zigzag encoded, so small negatives stay short
+    uint64_t raw = (uint64_t)(int64_t)value.value;
+    if (std::is_signed<T>::value) {
+        raw = (raw << 1) ^ (uint64_t)((int64_t)value.value >> 63);
+    }
+    writeVarint(data, raw);
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+NetVarint<T> NetSerializer<NetVarint<T>>::unpack(Memory::IAllocator& alloc, CBytes& data)
+{
+    uint64_t raw = 0;
+    if (!readVarint(data, &raw)) {
+        rejectInput(data);
+    }
+
+    if (std::is_signed<T>::value) {
+        raw = (raw >> 1) ^ (0 - (raw & 1));
+    }
+    return NetVarint<T>((T)raw);
+}
+
+// ----------------------------------------------------------------------------
+template <class T, size_t Bits>
+void NetSerializer<NetBits<T, Bits>>::pack(NetBitWriter& bits, NetBits<T, Bits> const& value)
+{
+    bits.write((uint64_t)value.value, Bits);
+}
+
+// ----------------------------------------------------------------------------
+template <class T, size_t Bits>
+NetBits<T, Bits> NetSerializer<NetBits<T, Bits>>::unpack(NetBitReader& bits)
+{
+    return NetBits<T, Bits>((T)bits.read(Bits));
+}
+
+// ----------------------------------------------------------------------------
+template <class T, size_t Bits>
+void NetSerializer<NetBits<T, Bits>>::pack(Memory::RegBuffer& data, NetBits<T, Bits> const& value)
+{
+    NetBitWriter bits(data);
+    pack(bits, value);
+    bits.flush();
+}
+
+// ----------------------------------------------------------------------------
+template <class T, size_t Bits>
+NetBits<T, Bits> NetSerializer<NetBits<T, Bits>>::unpack(Memory::IAllocator& alloc, CBytes& data)
+{
+    NetBitReader bits(data);
+    NetBits<T, Bits> value = unpack(bits);
+    bits.flush();
+    return value;
+}
+
+// ----------------------------------------------------------------------------
+template <int Min, int Max, size_t Bits>
+void NetSerializer<NetQuantized<Min, Max, Bits>>::pack(NetBitWriter& bits, NetQuantized<Min, Max, Bits> const& value)
+{
+    uint64_t const steps = (uint64_t(1) << Bits) - 1;
+
+    float clamped = Math::min(Math::max(value.value, (float)Min), (float)Max);
+    float scaled = (clamped - (float)Min) / (float)(Max - Min) * (float)steps;
+    bits.write((uint64_t)(scaled + 0.5f), Bits);
+}
+
+// ----------------------------------------------------------------------------
+template <int Min, int Max, size_t Bits>
+NetQuantized<Min, Max, Bits> NetSerializer<NetQuantized<Min, Max, Bits>>::unpack(NetBitReader& bits)
+{
+    uint64_t const steps = (uint64_t(1) << Bits) - 1;
+
+    float scaled = (float)bits.read(Bits);
+    return NetQuantized<Min, Max, Bits>((float)Min + scaled / (float)steps * (float)(Max - Min));
+}
+
+// ----------------------------------------------------------------------------
+template <int Min, int Max, size_t Bits>
+void NetSerializer<NetQuantized<Min, Max, Bits>>::pack(Memory::RegBuffer& data, NetQuantized<Min, Max, Bits> const& value)
+{
+    NetBitWriter bits(data);
+    pack(bits, value);
+    bits.flush();
+}
+
+// ----------------------------------------------------------------------------
+template <int Min, int Max, size_t Bits>
+NetQuantized<Min, Max, Bits> NetSerializer<NetQuantized<Min, Max, Bits>>::unpack(Memory::IAllocator& alloc, CBytes& data)
+{
+    NetBitReader bits(data);
+    NetQuantized<Min, Max, Bits> value = unpack(bits);
+    bits.flush();
+    return value;
+}
+
+// ----------------------------------------------------------------------------
+template <class T, bool Bitwise>
+template <class ValueTy>
+void NetArgument<T, Bitwise>::pack(NetBitWriter& bits, Memory::RegBuffer& data, ValueTy const& value)
+{
+    bits.flush();
+    NetSerializer<T>::pack(data, value);
+}
+
+// ----------------------------------------------------------------------------
+template <class T, bool Bitwise>
+T NetArgument<T, Bitwise>::unpack(NetBitReader& bits, Memory::IAllocator& alloc, CBytes& data)
+{
+    bits.flush();
+    return NetElementSerializer<T>::template unpack<T>(alloc, data);
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+template <class ValueTy>
+void NetArgument<T, true>::pack(NetBitWriter& bits, Memory::RegBuffer& data, ValueTy const& value)
+{
+    NetSerializer<T>::pack(bits, value);
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+T NetArgument<T, true>::unpack(NetBitReader& bits, Memory::IAllocator& alloc, CBytes& data)
+{
+    return NetSerializer<T>::unpack(bits);
+}
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "net_transport.h"
 
+#include <algorithm>
+#include <string.h>
+
 
 using namespace Data;
 
@@ -14,13 +17,374 @@ NetEventNames::NetEventNames(bool forSerialization)
     }
 }
 
+// ----------------------------------------------------------------------------
+void NetEventNames::hashHandlers(Memory::RaStack<NetHandlerHash>& table) const
+{
+    struct Scope {
+        size_t group;
+        uint64_t hash;
+        bool list;
+    };
+
+    Memory::RaStack<Scope> pending;
+    pending.append(Scope{ 0, RootHash, false });
+    while (!pending.isEmpty()) {
+        Scope scope = pending[pending.last()];
+        pending.pop();
+
+        auto rows = groups[scope.group].entries.rows;
+        for (size_t i = 0; i < count(rows); ++i) {
+            uint64_t hash = scope.list ? hashIndex(scope.hash, i) : hashName(scope.hash, rows[i].key);
+            if (rows[i].value.type == Entry::Handler) {
+                table.append(NetHandlerHash{ hash, rows[i].value.index });
+            }
+            else {
+                pending.append(Scope{ rows[i].value.index, hash, rows[i].value.type == Entry::List });
+            }
+        }
+    }
+
+    Array<NetHandlerHash> sorted = table.asArray();
+    std::sort(sorted.begin, sorted.end, [](NetHandlerHash const& lhs, NetHandlerHash const& rhs) {
+        return lhs.hash < rhs.hash;
+    });
+}
+
+// ----------------------------------------------------------------------------
+uint64_t NetEventNames::hashName(uint64_t scope, String const& name)
+{
+    // The separator keeps "ab" + "c" apart from "a" + "bc"
+    uint64_t hash = (scope ^ '.') * 1099511628211ull;
+    for (CByte byte : iterate(name)) {
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// ----------------------------------------------------------------------------
+uint64_t NetEventNames::hashIndex(uint64_t scope, size_t index)
+{
+    uint64_t hash = (scope ^ '#') * 1099511628211ull;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+        hash = (hash ^ (Byte)((uint64_t)index >> (i * 8))) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// ----------------------------------------------------------------------------
+NetFingerprint NetEventNames::fingerprint(CArray<NetHandlerHash> table)
+{
+    // Rows are hashed as little endian 64-bit pairs, builds of any word size agree
+    NetSha256 sha;
+    for (NetHandlerHash const& row : iterate(table)) {
+        Byte bytes[16];
+        for (size_t i = 0; i < 8; ++i) {
+            bytes[i] = (Byte)(row.hash >> (i * 8));
+            bytes[8 + i] = (Byte)((uint64_t)row.handler.value >> (i * 8));
+        }
+        sha.update(CBytes{ bytes, bytes + sizeof(bytes) });
+    }
+
+    Byte digest[32];
+    sha.finish(digest);
+
+    NetFingerprint result;
+    memcpy(result.words, digest, sizeof(result.words));
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// NetSha256 implementation
+// ----------------------------------------------------------------------------
+NetSha256::NetSha256()
+    : m_state{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 }
+    , m_length(0)
+{
+}
+
+// ----------------------------------------------------------------------------
+void NetSha256::update(CBytes data)
+{
+    while (!isEmpty(data)) {
+        size_t used = (size_t)(m_length % sizeof(m_block));
+        size_t size = std::min(sizeof(m_block) - used, count(data));
+        memcpy(m_block + used, data.begin, size);
+        m_length += size;
+        data.begin += size;
+
+        if (used + size == sizeof(m_block)) {
+            compress(m_block);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetSha256::finish(Byte (&digest)[32])
+{
+    uint64_t bits = m_length * 8;
+
+    // One bit, zeros up to the last 8 bytes of a block, then the bit length
+    Byte padding[72] = { 0x80 };
+    size_t used = (size_t)(m_length % sizeof(m_block));
+    size_t size = (used < 56 ? 56 : 120) - used;
+    for (size_t i = 0; i < 8; ++i) {
+        padding[size + i] = (Byte)(bits >> (56 - i * 8));
+    }
+    update(CBytes{ padding, padding + size + 8 });
+
+    for (size_t i = 0; i < 8; ++i) {
+        digest[i * 4 + 0] = (Byte)(m_state[i] >> 24);
+        digest[i * 4 + 1] = (Byte)(m_state[i] >> 16);
+        digest[i * 4 + 2] = (Byte)(m_state[i] >> 8);
+        digest[i * 4 + 3] = (Byte)(m_state[i]);
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetSha256::compress(Byte const* block)
+{
+    static uint32_t const K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+    auto rotr = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+
+    uint32_t w[64];
+    for (size_t i = 0; i < 16; ++i) {
+        w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 | (uint32_t)block[i * 4 + 2] << 8 | block[i * 4 + 3];
+    }
+    for (size_t i = 16; i < 64; ++i) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+    uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+    for (size_t i = 0; i < 64; ++i) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+
+    m_state[0] += a; m_state[1] += b; m_state[2] += c; m_state[3] += d;
+    m_state[4] += e; m_state[5] += f; m_state[6] += g; m_state[7] += h;
+}
+
+// ----------------------------------------------------------------------------
+// NetRoutingTable implementation
+// ----------------------------------------------------------------------------
+bool NetRoutingTable::build(CArray<NetHandlerHash> handlers)
+{
+    size_t keys = count(handlers);
+    if (keys > MaxHandlers) {
+        return false;
+    }
+
+    size_t buckets = 1;
+    while (buckets * BucketKeys < keys) {
+        buckets *= 2;
+    }
+    size_t slots = 1;
+    while (slots < keys + keys / SlotSlack) {
+        slots *= 2;
+    }
+    m_bucketMask = buckets - 1;
+    m_slotMask = slots - 1;
+
+    // Crowded buckets are split by more buckets, seeds which run out for an
+    // unlucky set of hashes are retried with more slots
+    for (size_t attempt = 0; attempt < MaxAttempts; ++attempt) {
+        Placement placement = place(handlers);
+        if (placement == Placement::Placed) {
+            return true;
+        }
+        if (placement == Placement::BucketOverflow) {
+            m_bucketMask = m_bucketMask * 2 + 1;
+        }
+        else {
+            m_slotMask = m_slotMask * 2 + 1;
+        }
+    }
+
+    // Hashes crafted into one bucket or colliding slots are not routed at all
+    m_seeds.clear();
+    m_slots.clear();
+    m_bucketMask = 0;
+    m_slotMask = 0;
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+size_t NetRoutingTable::lookup(uint64_t hash) const
+{
+    if (m_slots.isEmpty()) {
+        return SIZE_MAX;
+    }
+
+    uint32_t seed = m_seeds[(hash >> 32) & m_bucketMask];
+    NetHandlerHash const& slot = m_slots[slotOf(hash, seed) & m_slotMask];
+    return (slot.hash == hash) ? slot.handler.value : SIZE_MAX;
+}
+
+// ----------------------------------------------------------------------------
+uint64_t NetRoutingTable::slotOf(uint64_t hash, uint32_t seed)
+{
+    // SplitMix64 finalizer, a bijection, of the hash moved by the seed
+    uint64_t x = hash + seed * 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// ----------------------------------------------------------------------------
+auto NetRoutingTable::place(CArray<NetHandlerHash> handlers) -> Placement
+{
+    static constexpr uint32_t MaxSeed = 1 << 16;
+
+    m_seeds.clear();
+    m_slots.clear();
+    for (size_t i = 0; i <= m_bucketMask; ++i) {
+        m_seeds.append(0u);
+    }
+    for (size_t i = 0; i <= m_slotMask; ++i) {
+        m_slots.append(NetHandlerHash{ 0, SIZE_MAX });
+    }
+
+    Memory::RaStack<size_t> sizes;
+    for (size_t i = 0; i <= m_bucketMask; ++i) {
+        sizes.append(0);
+    }
+    for (NetHandlerHash const& handler : iterate(handlers)) {
+        ++sizes[(handler.hash >> 32) & m_bucketMask];
+    }
+
+    // The largest buckets are placed first, while most slots are free
+    Memory::RaStack<NetHandlerHash> order;
+    for (NetHandlerHash const& handler : iterate(handlers)) {
+        order.append(handler);
+    }
+    Array<NetHandlerHash> keys = order.asArray();
+    std::stable_sort(keys.begin, keys.end, [this, &sizes](NetHandlerHash const& lhs, NetHandlerHash const& rhs) {
+        size_t bucketL = (lhs.hash >> 32) & m_bucketMask;
+        size_t bucketR = (rhs.hash >> 32) & m_bucketMask;
+        if (sizes[bucketL] != sizes[bucketR]) return sizes[bucketL] > sizes[bucketR];
+        if (bucketL != bucketR) return bucketL < bucketR;
+        return lhs.hash < rhs.hash;
+    });
+
+    // Remote tables may repeat a hash, the first handler wins
+    size_t unique = 0;
+    for (size_t i = 0; i < count(keys); ++i) {
+        if (unique == 0 || keys[i].hash != keys[unique - 1].hash) {
+            keys[unique++] = keys[i];
+        }
+    }
+    keys = Array<NetHandlerHash>{ keys.begin, keys.begin + unique };
+
+    size_t placed[MaxBucketKeys];
+    for (size_t begin = 0, end = 0; begin < count(keys); begin = end) {
+        size_t bucket = (keys[begin].hash >> 32) & m_bucketMask;
+        for (end = begin + 1; end < count(keys) && ((keys[end].hash >> 32) & m_bucketMask) == bucket; ++end) {
+        }
+
+        // Far larger buckets than the average are split by more buckets
+        if (end - begin > MaxBucketKeys) return Placement::BucketOverflow;
+
+        uint32_t seed = 0;
+        for (; seed < MaxSeed; ++seed) {
+            size_t used = 0;
+            for (size_t i = begin; i < end; ++i) {
+                size_t slot = slotOf(keys[i].hash, seed) & m_slotMask;
+                bool free = (m_slots[slot].handler.value == SIZE_MAX);
+                for (size_t j = 0; free && j < used; ++j) {
+                    free = (placed[j] != slot);
+                }
+                if (!free) break;
+                placed[used++] = slot;
+            }
+            if (used == end - begin) break;
+        }
+        if (seed == MaxSeed) return Placement::SeedsExhausted;
+
+        m_seeds[bucket] = seed;
+        for (size_t i = begin; i < end; ++i) {
+            m_slots[placed[i - begin]] = keys[i];
+        }
+    }
+    return Placement::Placed;
+}
+
+// ----------------------------------------------------------------------------
+// NetSharedNames implementation
+// ----------------------------------------------------------------------------
+NetSharedNames::~NetSharedNames()
+{
+    for (NetEventNames::Group& group : iterate(names.groups.asArray())) {
+        group.~Group();
+    }
+}
+
+// ----------------------------------------------------------------------------
+uint64_t NetSharedNames::hashOf(NetEventNamesRef names)
+{
+    using Group = NetEventNames::Group;
+
+    uint64_t hash = NetEventNames::RootHash;
+    for (NetHandlerHash const& row : iterate(names.hashes)) {
+        hash = (hash ^ row.hash) * 1099511628211ull;
+        hash = (hash ^ row.handler.value) * 1099511628211ull;
+    }
+    for (Group const& group : iterate(names.groups)) {
+        hash = (hash ^ count(group.entries.rows)) * 1099511628211ull;
+        for (auto const& row : iterate(group.entries.rows)) {
+            hash = NetEventNames::hashName(hash, row.key);
+            hash = (hash ^ (row.value.index << 2 | row.value.type)) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+// ----------------------------------------------------------------------------
+bool NetSharedNames::isEqual(NetEventNamesRef lhs, NetEventNamesRef rhs)
+{
+    if (count(lhs.groups) != count(rhs.groups)) return false;
+    if (count(lhs.hashes) != count(rhs.hashes)) return false;
+
+    for (size_t i = 0; i < count(lhs.hashes); ++i) {
+        if (lhs.hashes[i].hash != rhs.hashes[i].hash) return false;
+        if (lhs.hashes[i].handler.value != rhs.hashes[i].handler.value) return false;
+    }
+
+    for (size_t i = 0; i < count(lhs.groups); ++i) {
+        auto rowsL = lhs.groups[i].entries.rows;
+        auto rowsR = rhs.groups[i].entries.rows;
+        if (count(rowsL) != count(rowsR)) return false;
+
+        for (size_t j = 0; j < count(rowsL); ++j) {
+            if (rowsL[j].key != rowsR[j].key) return false;
+            if (rowsL[j].value.type != rowsR[j].value.type) return false;
+            if (rowsL[j].value.index != rowsR[j].value.index) return false;
+        }
+    }
+    return true;
+}
+
 // ----------------------------------------------------------------------------
 // NetPeer implementation
 // ----------------------------------------------------------------------------
 NetPeer::NetPeer(size_t nonce, size_t buffers)
-    : nonce(nonce)
+    : nonce(nonce), names(nullptr), dictionary(nullptr)
 { 
     output.data = Tools::buildArray<Memory::RegBuffer>(nullptr, buffers);
+    output.ends = Tools::buildArray<Memory::RaStack<size_t>>(nullptr, buffers);
 }
 
 // ----------------------------------------------------------------------------
@@ -28,19 +392,20 @@ NetPeer::~NetPeer()
 {
     nonce = -1;
     Tools::destroyArray(output.data);
+    Tools::destroyArray(output.ends);
 }
 
 // ----------------------------------------------------------------------------
 // NetPeerId implementation
 // ----------------------------------------------------------------------------
 NetPeerId::NetPeerId()
-    : NetPeerId(-1, -1)
+    : NetPeerId(-1, -1, -1)
 {
 }
 
 // ----------------------------------------------------------------------------
-NetPeerId::NetPeerId(size_t index, size_t nonce)
-    : index(index), nonce(index)
+NetPeerId::NetPeerId(size_t index, size_t nonce, size_t shard)
+    : index(index), nonce(nonce), shard(shard)
 {
 }
 
@@ -61,6 +426,122 @@ bool NetPeerId::isValid() const
 }
 
 
+// ----------------------------------------------------------------------------
+// NetHostSchema implementation
+size_t NetHostSchema::channelsCount() const
+{
+    return channels.isEmpty() ? 1 : channels.count();
+}
+
+// ----------------------------------------------------------------------------
+enet_uint32 NetHostSchema::channelFlags(size_t channel) const
+{
+    NetChannelType type = channels.isEmpty() ? NetChannelType::ReliableOrdered : channels[channel];
+    switch (type) {
+    case NetChannelType::UnreliableSequenced:
+        return 0;
+    case NetChannelType::Unsequenced:
+        return ENET_PACKET_FLAG_UNSEQUENCED;
+    default:
+        return ENET_PACKET_FLAG_RELIABLE;
+    }
+}
+
+// ----------------------------------------------------------------------------
+void NetHostSchema::packHandler(Memory::RegBuffer& data, size_t hid) const
+{
+    if (wire == NetWireFormat::Compact) {
+        writeVarint(data, hid + 1);
+        return;
+    }
+    write(&data.reserve(sizeof(uint32_t)), (uint32_t)hid);
+}
+
+// ----------------------------------------------------------------------------
+size_t NetHostSchema::unpackHandler(CBytes& data) const
+{
+    if (wire == NetWireFormat::Compact) {
+        uint64_t id = 0;
+        if (!readVarint(data, &id)) {
+            rejectInput(data);
+            return SIZE_MAX;
+        }
+        return (id == 0) ? SIZE_MAX : (size_t)(id - 1);
+    }
+
+    uint32_t hid = UINT32_MAX;
+    if (!read(&data, &hid)) {
+        rejectInput(data);
+    }
+    return (hid == UINT32_MAX) ? SIZE_MAX : hid;
+}
+
+// ----------------------------------------------------------------------------
+CBytes NetHostSchema::terminator() const
+{
+    static uint32_t const fixed = UINT32_MAX;
+    static Byte const compact = 0;
+
+    if (wire == NetWireFormat::Compact) {
+        return toBytes(&compact, sizeof(compact));
+    }
+    return toBytes(&fixed, sizeof(fixed));
+}
+
+// ----------------------------------------------------------------------------
+void NetHostSchema::buildDictionary(Memory::RegBuffer& data, NetEventNamesRef remote) const
+{
+    using Group = NetEventNames::Group;
+    using Entry = NetEventNames::Entry;
+
+    Memory::RaStack<String> keys;
+    size_t handlersCount = 0;
+
+    // The remote strings are known only if it sent its tree, the hashed
+    // handshake leaves both ends with the handler ids alone
+    bool strings = !isEmpty(remote.groups);
+
+    // Anonymous handlers are missing from the trees, so both ends count the named ones only
+    auto collect = [&keys, &handlersCount, strings](NetEventNamesRef tree) {
+        for (Group const& group : iterate(tree.groups)) {
+            for (auto const& row : iterate(group.entries.rows)) {
+                if (strings) {
+                    keys.append(row.key);
+                }
+                if (row.value.type == Entry::Handler && row.value.index >= handlersCount) {
+                    handlersCount = row.value.index + 1;
+                }
+            }
+        }
+        for (NetHandlerHash const& row : iterate(tree.hashes)) {
+            if (row.handler.value >= handlersCount) {
+                handlersCount = row.handler.value + 1;
+            }
+        }
+    };
+    collect(names);
+    collect(remote);
+
+    // Hash map order depends on the insertion order, the sorted keys do not
+    Array<String> sorted = keys.asArray();
+    std::sort(sorted.begin, sorted.end, [](String const& lhs, String const& rhs) {
+        size_t common = std::min(count(lhs), count(rhs));
+        int order = memcmp(lhs.begin, rhs.begin, common);
+        return (order != 0) ? (order < 0) : (count(lhs) < count(rhs));
+    });
+
+    // Names as they are serialized, then the handler ids which start every message
+    for (size_t i = 0; i < count(sorted); ++i) {
+        if (i != 0 && sorted[i] == sorted[i - 1]) continue;
+        NetSerializer<String>::pack(data, sorted[i]);
+    }
+    for (size_t hid = 0; hid < handlersCount; ++hid) {
+        packHandler(data, hid);
+    }
+    write(&data.reserve(count(terminator())), terminator());
+}
+
+
 // ----------------------------------------------------------------------------
 void NetSerializer<String>::pack(Memory::RegBuffer& data, String const& value)
 {
@@ -72,8 +553,11 @@ void NetSerializer<String>::pack(Memory::RegBuffer& data, String const& value)
 // ----------------------------------------------------------------------------
 String NetSerializer<String>::unpack(Memory::IAllocator& a, CBytes& data)
 {
-    uint32_t strlen;
-    read(&data, &strlen);
+    uint32_t strlen = 0;
+    if (!read(&data, &strlen) || strlen > count(data)) {
+        rejectInput(data);
+        return String();
+    }
 
     Bytes str = Tools::newArray<Byte>(&a, strlen);
     read(&data, str);
@@ -81,19 +565,60 @@ String NetSerializer<String>::unpack(Memory::IAllocator& a, CBytes& data)
     return String(str);
 }
 
+// ----------------------------------------------------------------------------
+void NetSerializer<NetCompact<String>>::pack(Memory::RegBuffer& data, String const& value)
+{
+    writeVarint(data, count(value));
+    write(&data.reserve(count(value)), (CBytes)value);
+}
+
+// ----------------------------------------------------------------------------
+NetCompact<String> NetSerializer<NetCompact<String>>::unpack(Memory::IAllocator& a, CBytes& data)
+{
+    uint64_t strlen = 0;
+    if (!readVarint(data, &strlen) || strlen > count(data)) {
+        rejectInput(data);
+        return NetCompact<String>();
+    }
+
+    Bytes str = Tools::newArray<Byte>(&a, (size_t)strlen);
+    read(&data, str);
+
+    return NetCompact<String>(String(str));
+}
+
+// ----------------------------------------------------------------------------
+void NetSerializer<NetView<String>>::pack(Memory::RegBuffer& data, String const& value)
+{
+    NetSerializer<String>::pack(data, value);
+}
+
+// ----------------------------------------------------------------------------
+NetView<String> NetSerializer<NetView<String>>::unpack(Memory::IAllocator& a, CBytes& data)
+{
+    uint32_t strlen = 0;
+    if (!read(&data, &strlen) || strlen > count(data)) {
+        rejectInput(data);
+        return NetView<String>();
+    }
+
+    return NetView<String>(String(split<CByte>(&data, strlen)));
+}
+
 // ----------------------------------------------------------------------------
 void NetSerializer<NetEventNames::Entry>::pack(Memory::RegBuffer& data, Entry const& value)
 {
-    write(&data.reserve(sizeof(uint32_t)), (uint32_t)value.index);
-    write(&data.reserve(sizeof(uint32_t)), (uint32_t)value.type);
+    writeVarint(data, value.index);
+    writeVarint(data, value.type);
 }
 
 // ----------------------------------------------------------------------------
 auto NetSerializer<NetEventNames::Entry>::unpack(Memory::IAllocator& alloc, CBytes& data) -> Entry
 {
-    uint32_t index, type;
-    read(&data, &index);
-    read(&data, &type);
+    uint64_t index = 0, type = 0;
+    if (!readVarint(data, &index) || !readVarint(data, &type) || type > Entry::List) {
+        rejectInput(data);
+    }
 
     Entry entry;
     entry.index = index;
@@ -105,7 +630,7 @@ auto NetSerializer<NetEventNames::Entry>::unpack(Memory::IAllocator& alloc, CByt
 void NetSerializer<NetEventNames::Group>::pack(Memory::RegBuffer& data, Group const& value)
 {
     using Pair = Serializer::HashMapPair<String, Entry>;
-    NetSerializer<Array<Pair>>::pack<Row>(data, value.entries.rows);
+    NetSerializer<NetCompact<Array<Pair>>>::pack<Row>(data, value.entries.rows);
 }
 
 // ----------------------------------------------------------------------------
@@ -114,7 +639,7 @@ auto NetSerializer<NetEventNames::Group>::unpack(Memory::IAllocator& alloc, CByt
     using Pair = Serializer::HashMapPair<String, Entry>;
 
     Group group;
-    auto rows = NetSerializer<Array<Pair>>::unpack<Row>(alloc, data);
+    auto rows = NetSerializer<NetCompact<Array<Pair>>>::unpack<Row>(alloc, data);
     for (auto const& row : iterate(rows)) {
         group.entries.insert(row.key, row.value);
     }
@@ -124,15 +649,36 @@ auto NetSerializer<NetEventNames::Group>::unpack(Memory::IAllocator& alloc, CByt
 // ----------------------------------------------------------------------------
 void NetSerializer<NetEventNames>::pack(Memory::RegBuffer& data, NetEventNamesRef const& value)
 {
-    NetSerializer<Array<Group>>::pack(data, value.groups);
+    NetSerializer<NetCompact<Array<Group>>>::pack(data, value.groups);
 }
 
 // ----------------------------------------------------------------------------
 NetEventNames NetSerializer<NetEventNames>::unpack(Memory::IAllocator& alloc, CBytes& data)
 {
-    auto groups = NetSerializer<Array<Group>>::unpack<Group>(alloc, data);
+    auto groups = NetSerializer<NetCompact<Array<Group>>>::unpack<Group>(alloc, data);
+
+    // Every group but the root has one parent before it, so walking the tree
+    // from the root ends and visits each group once
+    Array<bool> parented = Tools::newArray<bool>(&alloc, count(groups));
+    for (bool& flag : iterate(parented)) {
+        flag = false;
+    }
+    for (size_t i = 0; i < count(groups) && !isRejected(data); ++i) {
+        for (auto const& row : iterate(groups[i].entries.rows)) {
+            if (row.value.type == Entry::Handler) continue;
+
+            size_t child = row.value.index;
+            if (child <= i || child >= count(groups) || parented[child]) {
+                rejectInput(data);
+                break;
+            }
+            parented[child] = true;
+        }
+    }
 
     NetEventNames names(true);
-    names.groups.insert(groups);
+    if (!isRejected(data)) {
+        names.groups.insert(groups);
+    }
     return std::move(names);
 }
\ No newline at end of file
@@ -1,10 +1,10 @@
 #pragma once
 
-#include "core/data/type_traits.h"
 #include "core/data/hash_map.h"
 #include "core/data/string.h"
 #include "core/data/array.h"
 
+#include "net_serializer.h"
 #include "enet/enet.h"
 
 
@@ -19,6 +19,49 @@ struct NetPacketIn {
 
 struct NetPacketOut {
     Array<Memory::RegBuffer> data;
+
+    // End offsets of the whole messages in every channel buffer
+    Array<Memory::RaStack<size_t>> ends;
+
+public:
+    void commit(size_t channel) { ends[channel].append(data[channel].size()); }
+};
+
+
+// Hash of a fully qualified handler name, e.g. "GameClient.load", with the
+// handler id. The compact handshake sends these instead of the names tree.
+struct NetHandlerHash {
+    uint64_t hash;
+    NetVarint<size_t> handler;
+};
+M_NET_FIELDS(NetHandlerHash, M_NET_FIELD(NetHandlerHash, hash), M_NET_FIELD(NetHandlerHash, handler));
+
+
+// Truncated SHA-256 of a handler table. Remote tables are cached under it, so
+// unlike the FNV name hashes it must not be forgeable.
+struct NetFingerprint {
+    uint64_t words[2];
+
+public:
+    bool operator==(NetFingerprint const& rhs) const { return words[0] == rhs.words[0] && words[1] == rhs.words[1]; }
+    bool operator!=(NetFingerprint const& rhs) const { return !(*this == rhs); }
+};
+
+
+// SHA-256 of the bytes passed to update()
+class NetSha256 {
+public:
+    NetSha256();
+
+    void update(Data::CBytes data);
+    void finish(Data::Byte (&digest)[32]);
+
+private:
+    uint32_t m_state[8];
+    Data::Byte m_block[64];
+    uint64_t m_length;
+
+    void compress(Data::Byte const* block);
 };
 
 
@@ -33,40 +76,121 @@ struct NetEventNames {
 public:
     Memory::RaStack<Group> groups;
 
+    // Handlers of a peer without groups, its routes are compiled from these
+    Memory::RaStack<NetHandlerHash> hashes;
+
+    // FNV-1a offset basis, the hash of the root scope
+    static constexpr uint64_t RootHash = 14695981039346656037ull;
+
 public:
     NetEventNames(bool forSerialization = false);
+
+    bool isHashed() const { return groups.isEmpty(); }
+
+    // Handlers of the tree sorted by hash, list items are hashed by position
+    void hashHandlers(Memory::RaStack<NetHandlerHash>& table) const;
+
+    static uint64_t hashName(uint64_t scope, Data::String const& name);
+    static uint64_t hashIndex(uint64_t scope, size_t index);
+    static NetFingerprint fingerprint(Data::CArray<NetHandlerHash> table);
+};
+
+
+// Handler hashes compiled into a perfect hash table. A lookup reads the seed
+// of the hash's bucket and the one slot the seed places it in.
+class NetRoutingTable {
+public:
+    NetRoutingTable() : m_bucketMask(0), m_slotMask(0) {}
+
+    // Duplicated hashes keep the first handler. False when the handlers do
+    // not fit in the limits, the table routes nothing then.
+    bool build(Data::CArray<NetHandlerHash> handlers);
+
+    // SIZE_MAX when the hash is not routed
+    size_t lookup(uint64_t hash) const;
+
+private:
+    enum class Placement { Placed, BucketOverflow, SeedsExhausted };
+
+    // Average keys per bucket and the share of empty slots
+    static constexpr size_t BucketKeys = 4;
+    static constexpr size_t SlotSlack = 4;
+
+    // Remote tables are untrusted, these bound the time and memory of a build
+    static constexpr size_t MaxBucketKeys = BucketKeys * 8;
+    static constexpr size_t MaxHandlers = 1 << 16;
+    static constexpr size_t MaxAttempts = 4;
+
+    Memory::RaStack<uint32_t> m_seeds;
+    Memory::RaStack<NetHandlerHash> m_slots;
+    uint64_t m_bucketMask;
+    uint64_t m_slotMask;
+
+    static uint64_t slotOf(uint64_t hash, uint32_t seed);
+    Placement place(Data::CArray<NetHandlerHash> handlers);
 };
 
 struct NetEventNamesRef {
     Data::Array<NetEventNames::Group> groups;
+    Data::Array<NetHandlerHash> hashes;
 
 public:
     NetEventNamesRef(NetEventNames const& names)
-        : groups(names.groups.asArray()) {}
+        : groups(names.groups.asArray()), hashes(names.hashes.asArray()) {}
+    NetEventNamesRef(Data::Array<NetEventNames::Group> groups, Data::Array<NetHandlerHash> hashes)
+        : groups(groups), hashes(hashes) {}
 };
 
 
 struct NetPeerId {
     size_t index;
     size_t nonce;
+    size_t shard;
 
 public:
     NetPeerId();
-    NetPeerId(size_t index, size_t nonce);
+    NetPeerId(size_t index, size_t nonce, size_t shard = 0);
 
     static size_t GenNonce(size_t& lastNonce);
     bool isValid() const;
 };
 
+// Names received from a remote build, interned by the shard and shared by
+// all of its peers which sent the same tree or hashes
+struct NetSharedNames {
+    NetEventNames names;
+    Memory::ChainAllocator strings;
+
+    // Built once per interned names, resolves events of all their peers
+    NetRoutingTable routes;
+
+    uint64_t hash;
+    size_t refs;
+
+public:
+    NetSharedNames() : names(true), hash(0), refs(0) {}
+    ~NetSharedNames();
+
+    // Content hash and comparison, the order of the entries matters
+    static uint64_t hashOf(NetEventNamesRef names);
+    static bool isEqual(NetEventNamesRef lhs, NetEventNamesRef rhs);
+};
+
+struct NetSharedDictionary;
+
 struct NetPeer {
     size_t nonce;
 
     Memory::RegBuffer dataIn;
-    Memory::RegBuffer dataOut;
 
     NetPacketIn input;
     NetPacketOut output;
-    NetEventNames names;
+
+    // Never null, peers start with the shard's empty names
+    NetSharedNames* names;
+
+    // Set once the names are exchanged if the host compresses with NetCompression::LzShared
+    NetSharedDictionary* dictionary;
 
     ENetPeer* enetPeer;
 
@@ -78,29 +202,99 @@ public:
 };
 
 
-namespace Serializer {
-    struct Plain {};
+class NetConnection;
 
-    struct Int32 {};
-    struct Int64 {};
+// Dispatch entry of a handler. The thunk is generated when the handler is
+// added, it unpacks the arguments from the input and calls the target.
+// False when the arguments are malformed, the target is not called then.
+struct NetHandlerRecord {
+    using Thunk = bool(*)(void* target, NetConnection& conn, Memory::IAllocator& frame, CBytes& input);
 
-    struct String {};
-    struct ZtString {};
+    Thunk thunk;
+    void* target;
+};
 
-    template <class K, class V>
-    struct HashMapRow {};
+// Encoding of the handler ids in a packet, both ends of a connection must agree
+enum class NetWireFormat {
+    Fixed,      // 32-bit ids, packet ends with UINT32_MAX
+    Compact,    // varint of id + 1, packet ends with a zero byte
+};
 
-    template <class K, class V>
-    struct HashMapPair {};
-}
+// Delivery of a channel, every channel maps to an ENet channel of the same index
+enum class NetChannelType {
+    ReliableOrdered,        // resent until acknowledged, delivered in order
+    UnreliableSequenced,    // may be lost, older packets than the last delivered are dropped
+    Unsequenced,            // may be lost or delivered in any order
+};
 
+// Compression of whole ENet datagrams, both ends of a connection must agree
+enum class NetCompression {
+    None,
+    RangeCoder,     // adaptive order-2 model, best ratio but slow
+    Lz,             // byte oriented LZ77, an order of magnitude faster
+    LzShared,       // Lz primed per connection with a dictionary of both names trees
+};
+
+// Read-only after the handlers are bound, shared by every shard of a host
+struct NetHostSchema {
+    Memory::RaStack<NetHandlerRecord> handlers;
+    Memory::RaStack<Memory::RaPool<NetPeer>*> shards;
+    Memory::RaStack<NetChannelType> channels;
+    NetEventNames names;
+    NetWireFormat wire;
+    NetCompression compression;
 
+public:
+    NetHostSchema() : wire(NetWireFormat::Fixed), compression(NetCompression::None) {}
+
+    NetPeer& peer(NetPeerId const& id) const { return (*shards[id.shard])[id.index]; }
+
+    size_t channelsCount() const;
+    enet_uint32 channelFlags(size_t channel) const;
+
+    // SIZE_MAX at the terminator, a truncated id rejects the input
+    void packHandler(Memory::RegBuffer& data, size_t hid) const;
+    size_t unpackHandler(CBytes& data) const;
+    CBytes terminator() const;
+
+    // Preset dictionary of a connection. Both ends hold the same two names
+    // trees after the handshake, so they build the same bytes.
+    void buildDictionary(Memory::RegBuffer& data, NetEventNamesRef remote) const;
+};
+
+
+// Handler argument unpacked as a view into the received packet instead of a
+// copy. The packet lives only until the handler returns, so do not keep it.
 template <class T>
-struct NetSerializer {
-    static_assert(Data::AlwaysFalse<T>::value, "NetSerializer not instanced for this type");
+struct NetView;
+
+template <>
+struct NetView<Data::String> : public Data::String {
+    NetView() = default;
+    NetView(Data::String const& str) : Data::String(str) {}
+};
+
+template <class T>
+struct NetView<Array<T>> : public Data::CArray<T> {
+    NetView() = default;
+    NetView(Data::CArray<T> const& elems) : Data::CArray<T>(elems) {}
+};
+
+
+// Handler argument with a varint length instead of a 32-bit one
+template <class T>
+struct NetCompact;
+
+template <>
+struct NetCompact<Data::String> : public Data::String {
+    NetCompact() = default;
+    NetCompact(Data::String const& str) : Data::String(str) {}
+};
 
-    static void pack(Memory::RegBuffer& data, T const& value);
-    static T unpack(Memory::IAllocator& alloc, CBytes& data);
+template <class T>
+struct NetCompact<Array<T>> : public Array<T> {
+    NetCompact() = default;
+    NetCompact(Array<T> const& elems) : Array<T>(elems) {}
 };
 
 
@@ -114,6 +308,38 @@ struct NetSerializer<Array<T>> {
     static Array<ElemTy> unpack(Memory::IAllocator& alloc, CBytes& data);
 };
 
+template <class T>
+struct NetSerializer<NetCompact<Array<T>>> {
+    template <class ElemTy>
+    static void pack(Memory::RegBuffer& data, Array<ElemTy> const& value);
+
+    template <class ElemTy>
+    static Array<ElemTy> unpack(Memory::IAllocator& alloc, CBytes& data);
+};
+
+// Arrays as handler arguments, the element type is the serializer one
+template <class T>
+struct NetElementSerializer<Array<T>> {
+    template <class ElemTy>
+    static ElemTy unpack(Memory::IAllocator& alloc, CBytes& data) { return NetSerializer<Array<T>>::template unpack<T>(alloc, data); }
+};
+
+template <class T>
+struct NetElementSerializer<NetCompact<Array<T>>> {
+    template <class ElemTy>
+    static ElemTy unpack(Memory::IAllocator& alloc, CBytes& data) { return NetSerializer<NetCompact<Array<T>>>::template unpack<T>(alloc, data); }
+};
+
+// Plain elements are copied as one block
+template <>
+struct NetSerializer<Array<Serializer::Plain>> {
+    template <class ElemTy>
+    static void pack(Memory::RegBuffer& data, Array<ElemTy> const& value);
+
+    template <class ElemTy>
+    static Array<ElemTy> unpack(Memory::IAllocator& alloc, CBytes& data);
+};
+
 // Hash map serialization
 template <class K, class V>
 struct NetSerializer<Serializer::HashMapPair<K, V>> {
@@ -158,5 +384,79 @@ struct NetSerializer<Data::String> {
     static Data::String unpack(Memory::IAllocator& alloc, CBytes& data);
 };
 
+template <>
+struct NetSerializer<NetCompact<Data::String>> {
+    static void pack(Memory::RegBuffer& data, Data::String const& value);
+    static NetCompact<Data::String> unpack(Memory::IAllocator& alloc, CBytes& data);
+};
+
+// Borrowed views serialization, wire compatible with the owning types
+template <>
+struct NetSerializer<NetView<Data::String>> {
+    static void pack(Memory::RegBuffer& data, Data::String const& value);
+    static NetView<Data::String> unpack(Memory::IAllocator& alloc, CBytes& data);
+};
+
+template <class T>
+struct NetSerializer<NetView<Array<T>>> {
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable elements can be viewed");
+
+    static void pack(Memory::RegBuffer& data, Data::CArray<T> const& value);
+    static NetView<Array<T>> unpack(Memory::IAllocator& alloc, CBytes& data);
+};
+
+
+// Fewest bytes of the variable sized types, counts and lengths come first
+template <class T>
+struct NetMinSize<Array<T>> {
+    static constexpr size_t value = sizeof(uint32_t);
+};
+
+template <class T>
+struct NetMinSize<NetCompact<Array<T>>> {
+    static constexpr size_t value = 1;
+};
+
+template <class T>
+struct NetMinSize<NetView<Array<T>>> {
+    static constexpr size_t value = sizeof(uint32_t);
+};
+
+template <>
+struct NetMinSize<Data::String> {
+    static constexpr size_t value = sizeof(uint32_t);
+};
+
+template <>
+struct NetMinSize<NetCompact<Data::String>> {
+    static constexpr size_t value = 1;
+};
+
+template <>
+struct NetMinSize<NetView<Data::String>> {
+    static constexpr size_t value = sizeof(uint32_t);
+};
+
+template <class K, class V>
+struct NetMinSize<Serializer::HashMapPair<K, V>>
+    : public NetMinSizeSum<K, V>
+{
+};
+
+template <>
+struct NetMinSize<NetEventNames::Entry> {
+    static constexpr size_t value = 2;
+};
+
+template <>
+struct NetMinSize<NetEventNames::Group> {
+    static constexpr size_t value = 1;
+};
+
+template <>
+struct NetMinSize<NetEventNames> {
+    static constexpr size_t value = 1;
+};
+
 
 #include "net_transport.hpp"
\ No newline at end of file
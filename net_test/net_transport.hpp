@@ -20,17 +20,112 @@ template <class T>
 template <class ElemTy>
 Data::Array<ElemTy> NetSerializer<Array<T>>::unpack(Memory::IAllocator& alloc, CBytes& data)
 {
-    uint32_t strlen;
-    read(&data, &strlen);
+    uint32_t strlen = 0;
+
+    // Counts are checked against the input, so a forged one cannot allocate more than it
+    if (!read(&data, &strlen) || strlen > Data::count(data) / Math::max<size_t>(NetMinSize<T>::value, 1)) {
+        rejectInput(data);
+        return Array<ElemTy>();
+    }
 
     Array<ElemTy> result = Tools::newArray<ElemTy>(&alloc, strlen);
     for (ElemTy& elem : Data::iterate(result)) {
-        elem = NetSerializer<T>::unpack(alloc, data);
+        elem = NetElementSerializer<T>::template unpack<ElemTy>(alloc, data);
+    }
+
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+template <class ElemTy>
+void NetSerializer<NetCompact<Array<T>>>::pack(Memory::RegBuffer& data, Array<ElemTy> const& value)
+{
+    writeVarint(data, Data::count(value));
+    for (ElemTy const& elem : Data::iterate(value)) {
+        NetSerializer<T>::pack(data, elem);
+    }
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+template <class ElemTy>
+Data::Array<ElemTy> NetSerializer<NetCompact<Array<T>>>::unpack(Memory::IAllocator& alloc, CBytes& data)
+{
+    uint64_t count = 0;
+    if (!readVarint(data, &count) || count > Data::count(data) / Math::max<size_t>(NetMinSize<T>::value, 1)) {
+        rejectInput(data);
+        return Array<ElemTy>();
+    }
+
+    Array<ElemTy> result = Tools::newArray<ElemTy>(&alloc, (size_t)count);
+    for (ElemTy& elem : Data::iterate(result)) {
+        elem = NetElementSerializer<T>::template unpack<ElemTy>(alloc, data);
+    }
+
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+template <class ElemTy>
+void NetSerializer<Array<Serializer::Plain>>::pack(Memory::RegBuffer& data, Array<ElemTy> const& value)
+{
+    static_assert(std::is_trivially_copyable<ElemTy>::value, "Only trivially copyable elements are plain");
+
+    uint32_t count = (uint32_t)Data::count(value);
+
+    write(&data.reserve(sizeof(uint32_t)), count);
+    write(&data.reserve(Data::size(value)), (CBytes)Data::toBytes(value));
+}
+
+// ----------------------------------------------------------------------------
+template <class ElemTy>
+Data::Array<ElemTy> NetSerializer<Array<Serializer::Plain>>::unpack(Memory::IAllocator& alloc, CBytes& data)
+{
+    static_assert(std::is_trivially_copyable<ElemTy>::value, "Only trivially copyable elements are plain");
+
+    uint32_t count = 0;
+    if (!read(&data, &count) || count > Data::count(data) / sizeof(ElemTy)) {
+        rejectInput(data);
+        return Array<ElemTy>();
     }
 
+    Array<ElemTy> result = Tools::newArray<ElemTy>(&alloc, count);
+    read(&data, Data::toBytes(result));
     return result;
 }
 
+// ----------------------------------------------------------------------------
+template <class T>
+void NetSerializer<NetView<Array<T>>>::pack(Memory::RegBuffer& data, Data::CArray<T> const& value)
+{
+    uint32_t count = (uint32_t)Data::count(value);
+
+    write(&data.reserve(sizeof(uint32_t)), count);
+    write(&data.reserve(Data::size(value)), Data::toBytes(value));
+}
+
+// ----------------------------------------------------------------------------
+template <class T>
+NetView<Array<T>> NetSerializer<NetView<Array<T>>>::unpack(Memory::IAllocator& alloc, CBytes& data)
+{
+    uint32_t count = 0;
+    if (!read(&data, &count) || count > Data::count(data) / sizeof(T)) {
+        rejectInput(data);
+        return NetView<Array<T>>();
+    }
+
+    CBytes elems = Data::split<Data::CByte>(&data, count * sizeof(T));
+
+    // Packet payload has no alignment guarantees, misaligned elements are copied
+    if ((uintptr_t)elems.begin % alignof(T) != 0) {
+        Array<T> copy = Tools::newArray<T>(&alloc, count);
+        Data::bytecopy(Data::toBytes(copy), elems);
+        return NetView<Array<T>>(copy);
+    }
+    return NetView<Array<T>>(Data::toArray<T>(elems));
+}
+
 // ----------------------------------------------------------------------------
 template <class K, class V>
 void NetSerializer<Serializer::HashMapPair<K, V>>::pack(Memory::RegBuffer& data, Row const& value)
@@ -44,7 +139,7 @@ template <class K, class V>
 auto NetSerializer<Serializer::HashMapPair<K, V>>::unpack(Memory::IAllocator& alloc, CBytes& data) -> Row
 {
     Row row;
-    row.key = std::move(NetSerializer<K>::unpack(alloc, data));
-    row.value = std::move(NetSerializer<V>::unpack(alloc, data));
+    row.key = std::move(NetElementSerializer<K>::template unpack<decltype(row.key)>(alloc, data));
+    row.value = std::move(NetElementSerializer<V>::template unpack<decltype(row.value)>(alloc, data));
     return row;
 }
\ No newline at end of file